@@ -3,8 +3,19 @@
 
 #include "core.h"
 #include "memory.h"
+#include "thread.h"
 
 #include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#include <cpuid.h>
+#define ARRAY_SIMD 1
+#define ARRAY_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define ARRAY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 #ifndef ASSERT_BOUNDS
 #define ASSERT_BOUNDS(i, min, max) do { ASSERT(i <= max); ASSERT(i >= min); } while(0)
@@ -14,7 +25,33 @@
 #define ANON_ARRAY(fields) struct anon_##__LINE__ { fields; }; Array<anon_##__LINE__>
 #define ARRAY(arr) (Array{ &arr[0], ARRAY_COUNT(arr) })
 
+// NOTE(jesper): partitions at or below this size are finished with an insertion sort
+#define SORT_INSERTION_THRESHOLD 16
+
+// NOTE(jesper): parallel_sort gives each thread at least this many elements, and
+// sorts smaller arrays on the calling thread
+#define PARALLEL_SORT_MIN_COUNT (32*1024)
+#define PARALLEL_SORT_MAX_THREADS 64
+
+// NOTE(jesper): alignment of each field's elements in a SoaArray
+#define SOA_ARRAY_FIELD_ALIGN 64
+
 // -- structures
+template<typename T>
+struct Array;
+
+template<typename T, i32 N>
+struct SmallArray;
+
+template<typename T>
+void array_relocate(T *dst, T *src, i32 count);
+
+template<typename T, i32 N>
+i32 array_add(SmallArray<T, N> *arr, const Array<T> es);
+
+template<typename T, i32 N>
+void array_destroy(SmallArray<T, N> *arr);
+
 template<typename T>
 struct Array {
     T *data = nullptr;
@@ -54,6 +91,13 @@ struct Array {
     {
         if (this->count != other.count) return false;
         if (this->data == other.data) return true;
+
+        // NOTE(jesper): integers and pointers compare equal exactly when their
+        // bytes do, which lets memcmp compare them in bulk
+        if constexpr (std::is_integral_v<T> || std::is_pointer_v<T>) {
+            return memcmp(this->data, other.data, this->count*sizeof(T)) == 0;
+        }
+
         for (i32 i = 0; i < this->count; i++) if (this->data[i] != other.data[i]) return false;
         return true;
     }
@@ -151,6 +195,109 @@ struct FixedArray : Array<T> {
     }
 };
 
+// NOTE(jesper): stores up to N elements inline and spills to alloc, mem_dynamic
+// by default, when it grows past that. data points into the object itself
+// while the elements are inline, so copies and moves re-point it at their own
+// storage; never memcpy a SmallArray. The elements and spilled memory are
+// released with array_destroy, which the destructor calls, so containers
+// holding SmallArrays must destroy the ones they drop
+template<typename T, i32 N>
+struct SmallArray : Array<T> {
+    i32 capacity = N;
+    Allocator alloc = {};
+    alignas(T) u8 storage[sizeof(T)*N];
+
+    bool is_inline() const { return this->data == (T*)storage; }
+
+    SmallArray()
+    {
+        this->data = (T*)storage;
+    }
+
+    explicit SmallArray(Allocator mem) : alloc(mem)
+    {
+        this->data = (T*)storage;
+    }
+
+    SmallArray(std::initializer_list<T> list)
+    {
+        this->data = (T*)storage;
+        array_add(this, Array<T>{ (T*)list.begin(), (i32)list.size() });
+    }
+
+    SmallArray(const SmallArray<T, N> &other) : alloc(other.alloc)
+    {
+        this->data = (T*)storage;
+        array_add(this, Array<T>{ other.data, other.count });
+    }
+
+    SmallArray(SmallArray<T, N> &&other) : alloc(other.alloc)
+    {
+        this->data = (T*)storage;
+        take(&other);
+    }
+
+    ~SmallArray() { array_destroy(this); }
+
+    SmallArray<T, N>& operator=(const SmallArray<T, N> &other)
+    {
+        if (this == &other) return *this;
+        array_destroy(this);
+
+        alloc = other.alloc;
+        array_add(this, Array<T>{ other.data, other.count });
+        return *this;
+    }
+
+    SmallArray<T, N>& operator=(SmallArray<T, N> &&other)
+    {
+        if (this == &other) return *this;
+        array_destroy(this);
+
+        alloc = other.alloc;
+        take(&other);
+        return *this;
+    }
+
+    void take(SmallArray<T, N> *other)
+    {
+        if (other->is_inline()) {
+            array_relocate(this->data, other->data, other->count);
+            capacity = N;
+        } else {
+            this->data = other->data;
+            capacity = other->capacity;
+        }
+
+        this->count = other->count;
+
+        other->data = (T*)other->storage;
+        other->count = 0;
+        other->capacity = N;
+    }
+};
+
+// NOTE(jesper): structure of arrays; stores the elements of each field
+// contiguously, field after field in a single allocation, so that a loop over
+// one field only touches that field's memory. Fields are addressed by index,
+// e.g. soa_field<0>(&arr) is an Array view of every element's first field.
+// Elements are moved with memcpy, so fields must be trivially copyable
+template<typename... Fields>
+struct SoaArray {
+    static_assert((std::is_trivially_copyable_v<Fields> && ...), "SoaArray fields must be trivially copyable");
+    static constexpr i32 field_count = sizeof...(Fields);
+
+    u8 *fields[field_count] = {};
+    i32 count = 0;
+    i32 capacity = 0;
+    Allocator alloc = {};
+};
+
+template<i32 I, typename T, typename... Rest>
+struct SoaFieldType { using Type = typename SoaFieldType<I-1, Rest...>::Type; };
+
+template<typename T, typename... Rest>
+struct SoaFieldType<0, T, Rest...> { using Type = T; };
 
 // -- iterators
 template<typename T>
@@ -270,6 +417,302 @@ ArrayIterator<T> iterator(T (&arr)[N]) { return { arr, N }; }
 template<typename T, i32 N>
 ReverseIterator<T> reverse(T (&arr)[N]) { return { arr, N }; }
 
+// -- simd search kernels
+// NOTE(jesper): vectorised find, count, and min/max over arrays of 4 and 8 byte
+// integers and pointers. The kernels are compiled for each instruction set with
+// target attributes, and the widest one the CPU supports is picked at runtime,
+// so the rest of the code base can keep its baseline x86-64 flags
+enum ArraySimdLevel : i32 {
+    ARRAY_SIMD_NONE,
+    ARRAY_SIMD_SSE2,
+    ARRAY_SIMD_SSE41,
+    ARRAY_SIMD_AVX2,
+};
+
+// NOTE(jesper): the byte size of T if the search kernels can operate on it, else 0
+template<typename T>
+constexpr i32 array_simd_size()
+{
+    if constexpr (std::is_integral_v<T> || std::is_pointer_v<T> || std::is_enum_v<T>) {
+        if constexpr (sizeof(T) == 4 || sizeof(T) == 8) return sizeof(T);
+    }
+
+    return 0;
+}
+
+template<typename U, typename T>
+U array_simd_bits(const T &value)
+{
+    static_assert(sizeof(U) == sizeof(T));
+    U bits;
+    memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+#if ARRAY_SIMD
+inline i32 array_simd_detect()
+{
+    u32 a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return ARRAY_SIMD_SSE2;
+
+    i32 level = (c & bit_SSE4_1) ? ARRAY_SIMD_SSE41 : ARRAY_SIMD_SSE2;
+
+    // NOTE(jesper): AVX2 also needs the OS to save the upper halves of the ymm
+    // registers on context switches, which it reports through XCR0
+    if (!(c & bit_OSXSAVE) || !(c & bit_AVX)) return level;
+
+    u32 xcr0_lo, xcr0_hi;
+    asm volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6) != 0x6) return level;
+
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return level;
+    return (b & bit_AVX2) ? ARRAY_SIMD_AVX2 : level;
+}
+
+inline i32 array_simd_level()
+{
+    static i32 level = array_simd_detect();
+    return level;
+}
+
+inline i32 array_find_index32_sse2(const u32 *data, i32 count, u32 value)
+{
+    __m128i needle = _mm_set1_epi32((i32)value);
+
+    i32 i = 0;
+    for (; i+4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data+i));
+        u32 mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+
+    for (; i < count; i++) if (data[i] == value) return i;
+    return -1;
+}
+
+ARRAY_TARGET_AVX2 inline i32 array_find_index32_avx2(const u32 *data, i32 count, u32 value)
+{
+    __m256i needle = _mm256_set1_epi32((i32)value);
+
+    i32 i = 0;
+    for (; i+8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data+i));
+        u32 mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, needle)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+
+    for (; i < count; i++) if (data[i] == value) return i;
+    return -1;
+}
+
+// NOTE(jesper): SSE2 has no 64-bit compare, so a lane matches when both of its
+// 32-bit halves do
+inline i32 array_find_index64_sse2(const u64 *data, i32 count, u64 value)
+{
+    __m128i needle = _mm_set1_epi64x((i64)value);
+
+    i32 i = 0;
+    for (; i+2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data+i));
+        u32 mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle)));
+        if ((mask & 0x3) == 0x3) return i;
+        if ((mask & 0xc) == 0xc) return i+1;
+    }
+
+    for (; i < count; i++) if (data[i] == value) return i;
+    return -1;
+}
+
+ARRAY_TARGET_AVX2 inline i32 array_find_index64_avx2(const u64 *data, i32 count, u64 value)
+{
+    __m256i needle = _mm256_set1_epi64x((i64)value);
+
+    i32 i = 0;
+    for (; i+4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data+i));
+        u32 mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, needle)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+
+    for (; i < count; i++) if (data[i] == value) return i;
+    return -1;
+}
+
+inline i32 array_count32_sse2(const u32 *data, i32 count, u32 value)
+{
+    __m128i needle = _mm_set1_epi32((i32)value);
+
+    i32 result = 0, i = 0;
+    for (; i+4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data+i));
+        result += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle))));
+    }
+
+    for (; i < count; i++) result += data[i] == value;
+    return result;
+}
+
+ARRAY_TARGET_AVX2 inline i32 array_count32_avx2(const u32 *data, i32 count, u32 value)
+{
+    __m256i needle = _mm256_set1_epi32((i32)value);
+
+    i32 result = 0, i = 0;
+    for (; i+8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data+i));
+        result += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, needle))));
+    }
+
+    for (; i < count; i++) result += data[i] == value;
+    return result;
+}
+
+inline i32 array_count64_sse2(const u64 *data, i32 count, u64 value)
+{
+    __m128i needle = _mm_set1_epi64x((i64)value);
+
+    i32 result = 0, i = 0;
+    for (; i+2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data+i));
+        u32 mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle)));
+        result += ((mask & 0x3) == 0x3) + ((mask & 0xc) == 0xc);
+    }
+
+    for (; i < count; i++) result += data[i] == value;
+    return result;
+}
+
+ARRAY_TARGET_AVX2 inline i32 array_count64_avx2(const u64 *data, i32 count, u64 value)
+{
+    __m256i needle = _mm256_set1_epi64x((i64)value);
+
+    i32 result = 0, i = 0;
+    for (; i+4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data+i));
+        result += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, needle))));
+    }
+
+    for (; i < count; i++) result += data[i] == value;
+    return result;
+}
+
+// NOTE(jesper): reduces a non-empty array of 32-bit integers to its largest, or
+// with is_max false its smallest, element. SSE2 has no 32-bit min/max, so the
+// narrowest kernel needs SSE4.1
+template<typename T, bool is_max>
+ARRAY_TARGET_SSE41 __m128i array_reduce32_step_sse41(__m128i a, __m128i b)
+{
+    if constexpr (std::is_signed_v<T>) return is_max ? _mm_max_epi32(a, b) : _mm_min_epi32(a, b);
+    else return is_max ? _mm_max_epu32(a, b) : _mm_min_epu32(a, b);
+}
+
+template<typename T, bool is_max>
+ARRAY_TARGET_AVX2 __m256i array_reduce32_step_avx2(__m256i a, __m256i b)
+{
+    if constexpr (std::is_signed_v<T>) return is_max ? _mm256_max_epi32(a, b) : _mm256_min_epi32(a, b);
+    else return is_max ? _mm256_max_epu32(a, b) : _mm256_min_epu32(a, b);
+}
+
+template<typename T, bool is_max>
+ARRAY_TARGET_SSE41 T array_reduce32_sse41(const T *data, i32 count)
+{
+    static_assert(sizeof(T) == 4 && std::is_integral_v<T>);
+
+    T result = data[0];
+    i32 i = 0;
+    if (count >= 4) {
+        __m128i acc = _mm_loadu_si128((const __m128i*)data);
+        for (i = 4; i+4 <= count; i += 4) acc = array_reduce32_step_sse41<T, is_max>(acc, _mm_loadu_si128((const __m128i*)(data+i)));
+
+        T lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for (T it : lanes) result = is_max ? MAX(result, it) : MIN(result, it);
+    }
+
+    for (; i < count; i++) result = is_max ? MAX(result, data[i]) : MIN(result, data[i]);
+    return result;
+}
+
+template<typename T, bool is_max>
+ARRAY_TARGET_AVX2 T array_reduce32_avx2(const T *data, i32 count)
+{
+    static_assert(sizeof(T) == 4 && std::is_integral_v<T>);
+
+    T result = data[0];
+    i32 i = 0;
+    if (count >= 8) {
+        __m256i acc = _mm256_loadu_si256((const __m256i*)data);
+        for (i = 8; i+8 <= count; i += 8) acc = array_reduce32_step_avx2<T, is_max>(acc, _mm256_loadu_si256((const __m256i*)(data+i)));
+
+        T lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for (T it : lanes) result = is_max ? MAX(result, it) : MIN(result, it);
+    }
+
+    for (; i < count; i++) result = is_max ? MAX(result, data[i]) : MIN(result, data[i]);
+    return result;
+}
+#endif // ARRAY_SIMD
+
+template<typename T>
+i32 array_simd_find_index(Array<T> arr, const T &value)
+{
+#if ARRAY_SIMD
+    if constexpr (array_simd_size<T>() == 4) {
+        u32 bits = array_simd_bits<u32>(value);
+        if (array_simd_level() >= ARRAY_SIMD_AVX2) return array_find_index32_avx2((const u32*)arr.data, arr.count, bits);
+        return array_find_index32_sse2((const u32*)arr.data, arr.count, bits);
+    } else if constexpr (array_simd_size<T>() == 8) {
+        u64 bits = array_simd_bits<u64>(value);
+        if (array_simd_level() >= ARRAY_SIMD_AVX2) return array_find_index64_avx2((const u64*)arr.data, arr.count, bits);
+        return array_find_index64_sse2((const u64*)arr.data, arr.count, bits);
+    }
+#endif
+
+    for (i32 i = 0; i < arr.count; i++) if (arr.data[i] == value) return i;
+    return -1;
+}
+
+template<typename T>
+i32 array_simd_count(Array<T> arr, const T &value)
+{
+#if ARRAY_SIMD
+    if constexpr (array_simd_size<T>() == 4) {
+        u32 bits = array_simd_bits<u32>(value);
+        if (array_simd_level() >= ARRAY_SIMD_AVX2) return array_count32_avx2((const u32*)arr.data, arr.count, bits);
+        return array_count32_sse2((const u32*)arr.data, arr.count, bits);
+    } else if constexpr (array_simd_size<T>() == 8) {
+        u64 bits = array_simd_bits<u64>(value);
+        if (array_simd_level() >= ARRAY_SIMD_AVX2) return array_count64_avx2((const u64*)arr.data, arr.count, bits);
+        return array_count64_sse2((const u64*)arr.data, arr.count, bits);
+    }
+#endif
+
+    i32 count = 0;
+    for (i32 i = 0; i < arr.count; i++) if (arr.data[i] == value) count++;
+    return count;
+}
+
+template<typename T, bool is_max>
+T array_simd_reduce(T curr, Array<T> arr)
+{
+#if ARRAY_SIMD
+    if constexpr (std::is_integral_v<T> && sizeof(T) == 4) {
+        if (arr.count > 0 && array_simd_level() >= ARRAY_SIMD_SSE41) {
+            T result = array_simd_level() >= ARRAY_SIMD_AVX2
+                ? array_reduce32_avx2<T, is_max>(arr.data, arr.count)
+                : array_reduce32_sse41<T, is_max>(arr.data, arr.count);
+            return is_max ? MAX(curr, result) : MIN(curr, result);
+        }
+    }
+#endif
+
+    for (auto it : arr) {
+        if (is_max ? it > curr : it < curr) curr = it;
+    }
+
+    return curr;
+}
+
 // -- array procedures
 template<typename T>
 Array<T> array(T *data, i32 count) { return Array<T>{ data, count }; }
@@ -350,6 +793,8 @@ Array<T> slice(Array<T> arr, i32 start)
 template<typename T>
 i32 array_find_index(Array<T> arr, T value)
 {
+    if constexpr (array_simd_size<T>() != 0) return array_simd_find_index(arr, value);
+
     for (i32 i = 0; i < arr.count; i++) if (arr[i] == value) return i;
     return -1;
 }
@@ -402,43 +847,104 @@ void array_swap(Array<T> arr, i32 a, i32 b, Array<K> arr1, Array<Tail>... tail)
     array_swap(arr1, a, b, tail...);
 }
 
+template<typename T, typename Compare, typename... Tail>
+void quick_sort(Array<T> arr, i32 l, i32 r, Compare compare, Array<Tail>... tail);
+
 template<typename T, typename... Tail>
 void exchange_sort(Array<T> arr, Array<Tail>... tail)
 {
-    for (int i = 0; i < arr.count; i++) {
-        for (int j = i+1; j < arr.count; j++) {
-            if (arr[i] > arr[j]) array_swap(arr, i, j, tail...);
+    quick_sort(arr, 0, arr.count-1, [](T &a, T &b) { return b > a; }, tail...);
+}
+
+template<typename T, typename Compare, typename... Tail>
+void insertion_sort(Array<T> arr, i32 l, i32 r, Compare compare, Array<Tail>... tail)
+{
+    for (i32 i = l+1; i <= r; i++) {
+        for (i32 j = i; j > l && compare(arr.data[j], arr.data[j-1]); j--) {
+            array_swap(arr, j, j-1, tail...);
         }
     }
 }
 
 template<typename T, typename Compare, typename... Tail>
-void quick_sort(Array<T> arr, i32 l, i32 r, Compare compare, Array<Tail>... tail)
+void heap_sift_down(Array<T> arr, i32 l, i32 root, i32 count, Compare compare, Array<Tail>... tail)
 {
-    if (l < 0 || r < 0 || l >= r) return;
+    while (true) {
+        i32 child = 2*root + 1;
+        if (child >= count) return;
+        if (child+1 < count && compare(arr.data[l+child], arr.data[l+child+1])) child++;
+        if (!compare(arr.data[l+root], arr.data[l+child])) return;
 
-    T pivot = arr[(r+l)/2];
+        array_swap(arr, l+root, l+child, tail...);
+        root = child;
+    }
+}
+
+template<typename T, typename Compare, typename... Tail>
+void heap_sort(Array<T> arr, i32 l, i32 r, Compare compare, Array<Tail>... tail)
+{
+    i32 count = r-l+1;
+    for (i32 i = count/2-1; i >= 0; i--) heap_sift_down(arr, l, i, count, compare, tail...);
 
-    i32 i = l-1;
-    i32 j = r+1;
+    for (i32 end = count-1; end > 0; end--) {
+        array_swap(arr, l, l+end, tail...);
+        heap_sift_down(arr, l, 0, end, compare, tail...);
+    }
+}
 
-    i32 pi = -1;
-    while (true) {
-        do i += 1; while(compare(arr[i], pivot));
-        do j -= 1; while(compare(pivot, arr[j]));
+// NOTE(jesper): quicksort with a median-of-three pivot that falls back to heap
+// sort once it has recursed deeper than depth, which bounds the worst case at
+// O(n log n), and finishes small partitions with an insertion sort. It
+// recurses into the smaller partition and loops on the larger one to keep the
+// stack depth logarithmic
+template<typename T, typename Compare, typename... Tail>
+void intro_sort(Array<T> arr, i32 l, i32 r, i32 depth, Compare compare, Array<Tail>... tail)
+{
+    while (r-l+1 > SORT_INSERTION_THRESHOLD) {
+        if (depth-- == 0) {
+            heap_sort(arr, l, r, compare, tail...);
+            return;
+        }
 
-        if (i >= j) {
-            pi = j;
-            break;
+        i32 m = l + (r-l)/2;
+        if (compare(arr.data[m], arr.data[l])) array_swap(arr, m, l, tail...);
+        if (compare(arr.data[r], arr.data[m])) {
+            array_swap(arr, r, m, tail...);
+            if (compare(arr.data[m], arr.data[l])) array_swap(arr, m, l, tail...);
         }
 
-        array_swap(arr, i, j, tail...);
+        T pivot = arr.data[m];
+
+        i32 i = l-1;
+        i32 j = r+1;
+        while (true) {
+            do i += 1; while (compare(arr.data[i], pivot));
+            do j -= 1; while (compare(pivot, arr.data[j]));
+            if (i >= j) break;
+
+            array_swap(arr, i, j, tail...);
+        }
+
+        if (j-l < r-j) {
+            intro_sort(arr, l, j, depth, compare, tail...);
+            l = j+1;
+        } else {
+            intro_sort(arr, j+1, r, depth, compare, tail...);
+            r = j;
+        }
     }
 
-    ASSERT(pi >= 0);
+    insertion_sort(arr, l, r, compare, tail...);
+}
 
-    quick_sort(arr, l, pi, compare, tail...);
-    quick_sort(arr, pi+1, r, compare, tail...);
+template<typename T, typename Compare, typename... Tail>
+void quick_sort(Array<T> arr, i32 l, i32 r, Compare compare, Array<Tail>... tail)
+{
+    if (l < 0 || r < 0 || l >= r) return;
+
+    i32 depth = 0;
+    for (i32 n = r-l+1; n > 1; n >>= 1) depth += 2;
+    intro_sort(arr, l, r, depth, compare, tail...);
 }
 
 template<typename T, typename Compare, typename... Tail>
@@ -447,6 +953,136 @@ void quick_sort(Array<T> arr, Compare compare, Array<Tail>... tail)
     quick_sort(arr, 0, arr.count-1, compare, tail...);
 }
 
+// NOTE(jesper): maps integer and floating point keys to unsigned integers that
+// sort in the same order
+template<typename K>
+auto radix_sort_key(K key)
+{
+    if constexpr (std::is_floating_point_v<K>) {
+        using U = std::conditional_t<sizeof(K) == 8, u64, u32>;
+        U bits;
+        memcpy(&bits, &key, sizeof bits);
+
+        U sign = U(1) << (sizeof(U)*8-1);
+        return (bits & sign) ? U(~bits) : U(bits | sign);
+    } else if constexpr (std::is_signed_v<K>) {
+        using U = std::make_unsigned_t<K>;
+        return U(U(key) ^ (U(1) << (sizeof(U)*8-1)));
+    } else {
+        return key;
+    }
+}
+
+// NOTE(jesper): stable LSD radix sort on the integer or floating point key
+// returned by key(element), one byte per pass. Passes where every element has
+// the same byte are skipped, so small key ranges only pay for the bytes that
+// differ
+template<typename T, typename Key>
+void radix_sort(Array<T> arr, Key key)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "radix_sort moves elements with memcpy");
+    if (arr.count <= 1) return;
+
+    using K = decltype(radix_sort_key(key(arr.data[0])));
+
+    SArena scratch = tl_scratch_arena();
+    T *src = arr.data;
+    T *dst = ALLOC_ARR(scratch, T, arr.count);
+
+    for (i32 shift = 0; shift < (i32)sizeof(K)*8; shift += 8) {
+        i32 offsets[256] = {};
+        for (i32 i = 0; i < arr.count; i++) offsets[(radix_sort_key(key(src[i])) >> shift) & 0xff]++;
+        if (offsets[(radix_sort_key(key(src[0])) >> shift) & 0xff] == arr.count) continue;
+
+        for (i32 i = 0, offset = 0; i < 256; i++) {
+            i32 count = offsets[i];
+            offsets[i] = offset;
+            offset += count;
+        }
+
+        for (i32 i = 0; i < arr.count; i++) {
+            dst[offsets[(radix_sort_key(key(src[i])) >> shift) & 0xff]++] = src[i];
+        }
+
+        SWAP(src, dst);
+    }
+
+    if (src != arr.data) memcpy(arr.data, src, arr.count*sizeof(T));
+}
+
+template<typename T>
+void radix_sort(Array<T> arr)
+{
+    radix_sort(arr, [](const T &e) { return e; });
+}
+
+// NOTE(jesper): splits the array into one chunk per thread, sorts the chunks
+// concurrently with quick_sort, then merges them pairwise on the calling thread.
+// The merges are stable, so equal elements keep the order quick_sort left them
+// in within each chunk. thread_count <= 0 uses every hardware thread
+template<typename T, typename Compare>
+void parallel_sort(Array<T> arr, Compare compare, i32 thread_count = 0)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "parallel_sort merges elements with memcpy");
+    if (thread_count <= 0) thread_count = hardware_thread_count();
+
+    i32 chunks = 1;
+    while (chunks*2 <= MIN(thread_count, PARALLEL_SORT_MAX_THREADS) &&
+           arr.count / (chunks*2) >= PARALLEL_SORT_MIN_COUNT)
+    {
+        chunks *= 2;
+    }
+
+    if (chunks == 1) {
+        quick_sort(arr, compare);
+        return;
+    }
+
+    struct SortJob {
+        Array<T> arr;
+        Compare *compare;
+    };
+
+    i32 bounds[PARALLEL_SORT_MAX_THREADS+1];
+    for (i32 i = 0; i <= chunks; i++) bounds[i] = (i32)((i64)arr.count * i / chunks);
+
+    SortJob jobs[PARALLEL_SORT_MAX_THREADS];
+    for (i32 i = 0; i < chunks; i++) {
+        jobs[i] = { .arr = slice(arr, bounds[i], bounds[i+1]), .compare = &compare };
+    }
+
+    Thread *threads[PARALLEL_SORT_MAX_THREADS];
+    for (i32 i = 1; i < chunks; i++) {
+        threads[i] = create_thread([](void *user_data) -> i32 {
+            auto *job = (SortJob*)user_data;
+            quick_sort(job->arr, *job->compare);
+            return 0;
+        }, &jobs[i]);
+    }
+
+    quick_sort(jobs[0].arr, compare);
+    for (i32 i = 1; i < chunks; i++) join_thread(threads[i]);
+
+    SArena scratch = tl_scratch_arena();
+    T *src = arr.data;
+    T *dst = ALLOC_ARR(scratch, T, arr.count);
+
+    for (i32 width = 1; width < chunks; width *= 2) {
+        for (i32 c = 0; c < chunks; c += 2*width) {
+            i32 i = bounds[c], mid = bounds[c+width], end = bounds[c+2*width];
+            i32 j = mid, k = i;
+
+            while (i < mid && j < end) dst[k++] = compare(src[j], src[i]) ? src[j++] : src[i++];
+            while (i < mid) dst[k++] = src[i++];
+            while (j < end) dst[k++] = src[j++];
+        }
+
+        SWAP(src, dst);
+    }
+
+    if (src != arr.data) memcpy(arr.data, src, arr.count*sizeof(T));
+}
+
 template<typename T, typename Compare = decltype([](T &a, T &b) { return a < b; })>
 void array_sort(Array<T> arr, Compare compare = {})
 {
@@ -456,10 +1092,21 @@ void array_sort(Array<T> arr, Compare compare = {})
 template<typename T>
 T array_max(T curr, Array<T> arr)
 {
+    if constexpr (std::is_integral_v<T>) return array_simd_reduce<T, true>(curr, arr);
+
     for (auto it : arr) if (it > curr) curr = it;
     return curr;
 }
 
+template<typename T>
+T array_min(T curr, Array<T> arr)
+{
+    if constexpr (std::is_integral_v<T>) return array_simd_reduce<T, false>(curr, arr);
+
+    for (auto it : arr) if (it < curr) curr = it;
+    return curr;
+}
+
 template<typename T>
 i32 array_count_if(Array<T> arr, bool (*predicate)(T &e))
 {
@@ -471,12 +1118,48 @@ i32 array_count_if(Array<T> arr, bool (*predicate)(T &e))
 template<typename T>
 i32 array_count(Array<T> arr, const T &needle)
 {
+    if constexpr (array_simd_size<T>() != 0) return array_simd_count(arr, needle);
+
     i32 count = 0;
     for (i32 i = 0; i < arr.count; i++) if (arr[i] == needle) count++;
     return count;
 }
 
 // -- dynamic array procedures
+
+// NOTE(jesper): moves count elements from src to the uninitialised dst and ends
+// the lifetime of the source elements. The ranges must not overlap
+template<typename T>
+void array_relocate(T *dst, T *src, i32 count)
+{
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        if (count > 0) memcpy(dst, src, count*sizeof(T));
+    } else {
+        for (i32 i = 0; i < count; i++) {
+            new (&dst[i]) T(RMOV(src[i]));
+            src[i].~T();
+        }
+    }
+}
+
+// NOTE(jesper): moves the elements in [at, arr->count) count slots along to make
+// room for count new elements at at. The opened slots are left uninitialised
+// for the caller to construct into; arr->count is not updated
+template<typename T>
+void array_open_gap(DynamicArray<T> *arr, i32 at, i32 count)
+{
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        memmove(&arr->data[at+count], &arr->data[at], (arr->count-at)*sizeof(T));
+    } else {
+        for (i32 i = arr->count-1; i >= at; i--) {
+            if (i+count >= arr->count) new (&arr->data[i+count]) T(RMOV(arr->data[i]));
+            else arr->data[i+count] = RMOV(arr->data[i]);
+        }
+
+        for (i32 i = at; i < MIN(at+count, arr->count); i++) arr->data[i].~T();
+    }
+}
+
 template<typename T>
 void array_grow(DynamicArray<T> *arr, i32 additional_elements)
 {
@@ -485,10 +1168,18 @@ void array_grow(DynamicArray<T> *arr, i32 additional_elements)
 
     i32 old_capacity = arr->capacity;
     arr->capacity = MAX(arr->count+additional_elements, old_capacity*2);
+
+    // NOTE(jesper): trivially copyable elements can be moved by the allocator,
+    // which lets it grow the block in place or remap it instead of copying
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        arr->data = REALLOC_ARR(arr->alloc, T, arr->data, old_capacity, arr->capacity);
+        return;
+    }
+
     T *nptr = EXTEND_ARR(arr->alloc, T, arr->data, old_capacity, arr->capacity);
 
     if (nptr != arr->data) {
-        for (i32 i = 0; i < arr->count; i++) new (&nptr[i]) T(arr->data[i]);
+        array_relocate(nptr, arr->data, arr->count);
         FREE(arr->alloc, arr->data);
     }
 
@@ -582,6 +1273,24 @@ i32 array_add(DynamicArray<T> *arr, const T& e)
     return arr->count++;
 }
 
+template<typename T>
+i32 array_add(DynamicArray<T> *arr, T&& e)
+{
+    array_grow(arr, 1);
+    new (&arr->data[arr->count]) T(RMOV(e));
+    return arr->count++;
+}
+
+// NOTE(jesper): constructs the new element in place from args
+template<typename T, typename... Args>
+T* array_emplace(DynamicArray<T> *arr, Args&&... args)
+{
+    array_grow(arr, 1);
+    T *e = new (&arr->data[arr->count]) T(RFWD(args)...);
+    arr->count++;
+    return e;
+}
+
 inline i32 array_add(DynamicArray<const char*> *arr, const char *e)
 {
     array_grow(arr, 1);
@@ -629,27 +1338,32 @@ i32 array_insert(DynamicArray<T> *arr, i32 insert_at, const T& e)
     ASSERT_BOUNDS(insert_at, 0, arr->count);
     array_grow(arr, 1);
 
-    for (i32 i = arr->count; i > insert_at; i--) arr->data[i] = arr->data[i-1];
+    array_open_gap(arr, insert_at, 1);
     new (&arr->data[insert_at]) T(e);
     arr->count++;
     return insert_at;
 }
 
+template<typename T>
+i32 array_insert(DynamicArray<T> *arr, i32 insert_at, T&& e)
+{
+    ASSERT_BOUNDS(insert_at, 0, arr->count);
+    array_grow(arr, 1);
+
+    array_open_gap(arr, insert_at, 1);
+    new (&arr->data[insert_at]) T(RMOV(e));
+    arr->count++;
+    return insert_at;
+}
+
 template<typename T>
 i32 array_insert(DynamicArray<T> *arr, i32 insert_at, const T *es, i32 count)
 {
     ASSERT_BOUNDS(insert_at, 0, arr->count);
     array_grow(arr, count);
 
-    for (i32 i = arr->count+count-1, j = insert_at;
-         j < arr->count;
-         j++,i--)
-    {
-        arr->data[i] = arr->data[j];
-    }
-
-    for (i32 i = 0; i < count; i++)
-        new (&arr->data[insert_at+i]) T(es[i]);
+    array_open_gap(arr, insert_at, count);
+    for (i32 i = 0; i < count; i++) new (&arr->data[insert_at+i]) T(es[i]);
 
     arr->count += count;
     return insert_at;
@@ -661,7 +1375,7 @@ i32 array_insert(DynamicArray<T> *arr, i32 insert_at, const Array<T> es)
     ASSERT_BOUNDS(insert_at, 0, arr->count);
     array_grow(arr, es.count);
 
-    for (i32 i = arr->count+es.count-1; i > insert_at; i--) arr->data[i] = arr->data[i-1];
+    array_open_gap(arr, insert_at, es.count);
     for (i32 i = 0; i < es.count; i++) new (&arr->data[insert_at+i]) T(es[i]);
     arr->count += es.count;
     return insert_at;
@@ -750,4 +1464,220 @@ void array_grow(FixedArray<T, N> *arr, i32 additional_elements)
     arr->count = MIN(arr->capacity(), arr->count+additional_elements);
 }
 
+// -- small array procedures
+template<typename T, i32 N>
+void array_grow(SmallArray<T, N> *arr, i32 additional_elements)
+{
+    if (arr->capacity >= arr->count+additional_elements) return;
+    if (!arr->alloc.proc) arr->alloc = mem_dynamic;
+
+    i32 old_capacity = arr->capacity;
+    arr->capacity = MAX(arr->count+additional_elements, old_capacity*2);
+
+    if (arr->is_inline()) {
+        T *nptr = ALLOC_ARR(arr->alloc, T, arr->capacity);
+        array_relocate(nptr, arr->data, arr->count);
+        arr->data = nptr;
+        return;
+    }
+
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        arr->data = REALLOC_ARR(arr->alloc, T, arr->data, old_capacity, arr->capacity);
+        return;
+    }
+
+    T *nptr = EXTEND_ARR(arr->alloc, T, arr->data, old_capacity, arr->capacity);
+    if (nptr != arr->data) {
+        array_relocate(nptr, arr->data, arr->count);
+        FREE(arr->alloc, arr->data);
+    }
+
+    arr->data = nptr;
+}
+
+template<typename T, i32 N>
+void array_reserve(SmallArray<T, N> *arr, i32 capacity)
+{
+    if (arr->capacity < capacity) array_grow(arr, capacity-arr->count);
+}
+
+// NOTE(jesper): releases any spilled memory and returns to the inline storage
+template<typename T, i32 N>
+void array_destroy(SmallArray<T, N> *arr)
+{
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+        for (i32 i = 0; i < arr->count; i++) arr->data[i].~T();
+    }
+
+    if (!arr->is_inline()) FREE(arr->alloc, arr->data);
+
+    arr->data = (T*)arr->storage;
+    arr->count = 0;
+    arr->capacity = N;
+}
+
+template<typename T, i32 N>
+void array_reset(SmallArray<T, N> *arr)
+{
+    array_destroy(arr);
+}
+
+template<typename T, i32 N>
+void array_clear(SmallArray<T, N> *arr)
+{
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+        for (i32 i = 0; i < arr->count; i++) arr->data[i].~T();
+    }
+
+    arr->count = 0;
+}
+
+template<typename T, i32 N>
+i32 array_add(SmallArray<T, N> *arr, const T &e)
+{
+    array_grow(arr, 1);
+    new (&arr->data[arr->count]) T(e);
+    return arr->count++;
+}
+
+template<typename T, i32 N>
+i32 array_add(SmallArray<T, N> *arr, T &&e)
+{
+    array_grow(arr, 1);
+    new (&arr->data[arr->count]) T(RMOV(e));
+    return arr->count++;
+}
+
+template<typename T, i32 N>
+i32 array_add(SmallArray<T, N> *arr, const Array<T> es)
+{
+    array_grow(arr, es.count);
+    for (i32 i = 0; i < es.count; i++) new (&arr->data[arr->count+i]) T(es.data[i]);
+    i32 start_index = arr->count;
+    arr->count += es.count;
+    return start_index;
+}
+
+template<typename T, i32 N, typename... Args>
+T* array_emplace(SmallArray<T, N> *arr, Args&&... args)
+{
+    array_grow(arr, 1);
+    T *e = new (&arr->data[arr->count]) T(RFWD(args)...);
+    arr->count++;
+    return e;
+}
+
+// -- soa array procedures
+template<i32 I, typename... F>
+Array<typename SoaFieldType<I, F...>::Type> soa_field(SoaArray<F...> *arr)
+{
+    using T = typename SoaFieldType<I, F...>::Type;
+    return { (T*)arr->fields[I], arr->count };
+}
+
+template<typename... F>
+void array_reserve(SoaArray<F...> *arr, i32 capacity)
+{
+    if (arr->capacity >= capacity) return;
+    if (!arr->alloc.proc) arr->alloc = mem_dynamic;
+
+    i64 offsets[sizeof...(F)];
+    i64 size = 0;
+    i32 i = 0;
+    ((offsets[i++] = size, size += (sizeof(F)*capacity + SOA_ARRAY_FIELD_ALIGN-1) & ~(i64)(SOA_ARRAY_FIELD_ALIGN-1)), ...);
+
+    u8 *block = (u8*)ALLOC_A(arr->alloc, size, SOA_ARRAY_FIELD_ALIGN);
+    if (arr->count > 0) {
+        i = 0;
+        ((memcpy(block + offsets[i], arr->fields[i], sizeof(F)*arr->count), i++), ...);
+    }
+
+    if (arr->fields[0]) FREE(arr->alloc, arr->fields[0]);
+    for (i = 0; i < arr->field_count; i++) arr->fields[i] = block + offsets[i];
+    arr->capacity = capacity;
+}
+
+template<typename... F>
+void array_grow(SoaArray<F...> *arr, i32 additional_elements)
+{
+    if (arr->capacity >= arr->count+additional_elements) return;
+    array_reserve(arr, MAX(arr->count+additional_elements, arr->capacity*2));
+}
+
+template<typename... F>
+void array_reset(SoaArray<F...> *arr)
+{
+    if (arr->fields[0]) FREE(arr->alloc, arr->fields[0]);
+    for (auto &it : arr->fields) it = nullptr;
+    arr->count = arr->capacity = 0;
+}
+
+template<typename... F>
+void array_clear(SoaArray<F...> *arr)
+{
+    arr->count = 0;
+}
+
+template<typename... F, i32... I>
+void soa_set(SoaArray<F...> *arr, i32 index, std::integer_sequence<i32, I...>, const F&... values)
+{
+    ((soa_field<I>(arr).data[index] = values), ...);
+}
+
+template<typename... F>
+void soa_set(SoaArray<F...> *arr, i32 index, const std::type_identity_t<F>&... values)
+{
+    ASSERT_BOUNDS(index, 0, arr->count-1);
+    soa_set(arr, index, std::make_integer_sequence<i32, sizeof...(F)>{}, values...);
+}
+
+template<typename... F>
+i32 array_add(SoaArray<F...> *arr, const std::type_identity_t<F>&... values)
+{
+    array_grow(arr, 1);
+    soa_set(arr, arr->count++, values...);
+    return arr->count-1;
+}
+
+template<typename... F>
+void array_remove(SoaArray<F...> *arr, i32 index)
+{
+    ASSERT_BOUNDS(index, 0, arr->count-1);
+
+    i32 i = 0;
+    ((memmove(arr->fields[i] + index*sizeof(F), arr->fields[i] + (index+1)*sizeof(F), (arr->count-index-1)*sizeof(F)), i++), ...);
+    arr->count--;
+}
+
+template<typename... F>
+void array_remove_unsorted(SoaArray<F...> *arr, i32 index)
+{
+    ASSERT_BOUNDS(index, 0, arr->count-1);
+
+    i32 i = 0;
+    ((memcpy(arr->fields[i] + index*sizeof(F), arr->fields[i] + (arr->count-1)*sizeof(F), sizeof(F)), i++), ...);
+    arr->count--;
+}
+
+template<i32 Key, typename Compare, typename... F, i32... I>
+void soa_sort(SoaArray<F...> *arr, Compare compare, std::integer_sequence<i32, I...>)
+{
+    quick_sort(soa_field<Key>(arr), compare, soa_field<(I < Key ? I : I+1)>(arr)...);
+}
+
+// NOTE(jesper): sorts the elements by field Key, which the other fields follow
+// as quick_sort's tail arrays
+template<i32 Key, typename... F, typename Compare>
+void soa_sort(SoaArray<F...> *arr, Compare compare)
+{
+    soa_sort<Key>(arr, compare, std::make_integer_sequence<i32, sizeof...(F)-1>{});
+}
+
+template<i32 Key, typename... F>
+void soa_sort(SoaArray<F...> *arr)
+{
+    using T = typename SoaFieldType<Key, F...>::Type;
+    soa_sort<Key>(arr, [](T &a, T &b) { return a < b; });
+}
+
 #endif // ARRAY_H
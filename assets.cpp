@@ -135,7 +135,6 @@ i32 get_asset_type(AssetHandle handle)
 
 Asset* get_loaded_asset(AssetHandle handle)
 {
-    SArena scratch = tl_scratch_arena();
     ASSERT(handle != ASSET_HANDLE_INVALID);
 
     Asset *asset = &assets.loaded[handle.index];
@@ -148,7 +147,8 @@ Asset* get_asset(AssetHandle handle)
     Asset *asset = get_loaded_asset(handle);
 
     if (!asset->data) {
-        FileInfo fi = read_file(asset->path, mem_dynamic);
+        SArena scratch = tl_scratch_arena();
+        FileInfo fi = read_file(asset->path, scratch);
         if (!fi.data) {
             LOG_ERROR("unable to load asset '%.*s'", STRFMT(asset->path));
             return nullptr;
@@ -357,7 +357,14 @@ AssetHandle load_asset(String path)
         return ASSET_HANDLE_INVALID;
     }
 
-    FileInfo file = read_file(apath, mem_dynamic);
+    // NOTE(jesper): apath lives in the scratch arena, so the contents are read into one that doesn't conflict with it. Load procs copy whatever they retain, the same as in ensure_loaded
+    SArena file_scratch = tl_scratch_arena(scratch);
+    FileInfo file = read_file(apath, file_scratch);
+    if (!file.data) {
+        LOG_ERROR("unable to load asset '%.*s'", STRFMT(apath));
+        return ASSET_HANDLE_INVALID;
+    }
+
     return load_asset(apath, file.data, file.size);
 }
 
@@ -508,7 +515,9 @@ String resolve_asset_path(String path, Allocator mem)
 
 String normalise_asset_path(String path, Allocator mem)
 {
-    String short_path = resolve_asset_path(path, mem);
+    // NOTE(jesper): the resolved path is only a candidate and short_path may end up a slice of the caller's path, so resolve into scratch and copy the result into mem once, rather than leaving a discarded path in mem and fixing up slashes in the caller's string
+    SArena scratch = tl_scratch_arena(mem);
+    String short_path = resolve_asset_path(path, scratch);
 
     for (auto f : assets.folders) {
         if (starts_with(path, f)) {
@@ -517,6 +526,7 @@ String normalise_asset_path(String path, Allocator mem)
         }
     }
 
+    short_path = duplicate_string(short_path, mem);
     for (i32 i = 0; i < short_path.length; i++) {
         if (short_path[i] == '\\') short_path[i] = '/';
     }
@@ -87,6 +87,7 @@ typedef u64 uptr;
 
 #if defined(__clang__)
 #define atomic_exchange(var, value) __sync_lock_test_and_set(var, value)
+#define atomic_load(var) __atomic_load_n(var, __ATOMIC_ACQUIRE)
 
 #define atomic_compare_exchange(var, old_val, new_val) __sync_bool_compare_and_swap(var, old_val, new_val)
 
@@ -96,6 +97,8 @@ typedef u64 uptr;
 #define atomic_fetch_and(var, value) __sync_fetch_and_and(var, value)
 #define atomic_fetch_xor(var, value) __sync_fetch_and_xor(var, value)
 #define atomic_fetch_nand(var, value) __sync_fetch_and_nand(var, value)
+
+#define cpu_pause() __builtin_ia32_pause()
 #else
 #error "unsupported compiler"
 #endif
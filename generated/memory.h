@@ -3,33 +3,121 @@
 
 extern void init_default_allocators();
 extern i32 get_page_size();
-extern void *virtual_reserve(i64 size);
+extern void *virtual_reserve(i64 size, u32 flags, u32 *obtained_flags);
 extern void *virtual_commit(void *addr, i64 size);
-extern Allocator linear_allocator(i64 size);
+extern void virtual_decommit(void *addr, i64 size);
+extern void *virtual_map(i64 size);
+extern void *virtual_remap(void *addr, i64 old_size, i64 size, bool may_move);
+extern void virtual_unmap(void *addr, i64 size);
+extern i32 current_numa_node();
+extern i32 virtual_numa_node(void *addr);
+extern Allocator linear_allocator(i64 size, u32 flags, const char *name);
 extern Allocator malloc_allocator();
-extern Allocator tl_linear_allocator(i64 size);
-extern Allocator vm_freelist_allocator(i64 max_size);
-extern MArena tl_arena(i32 initial_size);
+extern Allocator tl_linear_allocator(i64 size, u32 flags, const char *name);
+extern Allocator tl_block_allocator(i64 block_size, Allocator backing, const char *name);
+extern Allocator vm_freelist_allocator(i64 max_size, u32 flags, const char *name);
+extern Allocator tl_cache_allocator(Allocator vm_freelist);
+extern Allocator slab_allocator(i64 max_size);
+extern Allocator tracking_allocator(Allocator backing);
+extern AllocatorNode *register_allocator(Allocator alloc, const char *name);
+extern void unregister_allocator(AllocatorNode *node);
+extern MArena tl_arena(i32 initial_size, const char *name);
+extern MArena tl_scratch_arena(const Allocator *conflicts, i32 count);
+extern MArena tl_scratch_arena(std::initializer_list<Allocator> conflicts);
 extern MArena tl_scratch_arena(Allocator conflict);
 extern void release_arena(MArena *arena);
 extern void restore_arena(MArena *arena);
 extern AllocatorInfo get_allocator_info(Allocator alloc);
+extern SlabAllocatorInfo get_slab_allocator_info(Allocator slab);
+extern i32 get_tracked_callsites(Allocator tracking, TrackedCallsite *dst, i32 max_count);
+extern void log_tracking_report(Allocator tracking, i32 max_callsites);
+extern i32 get_allocator_snapshots(AllocatorSnapshot *dst, i32 max_count);
+extern void log_allocator_report();
 extern i32 tl_scratch_idx(MArena arena);
 extern void *align_ptr(void *ptr, u8 alignment, u8 header_size);
 extern void init_default_allocators();
+extern MArena tl_scratch_arena(const Allocator *conflicts, i32 count);
+extern MArena tl_scratch_arena(std::initializer_list<Allocator> conflicts);
 extern MArena tl_scratch_arena(Allocator conflict);
-extern MArena tl_arena(i32 initial_size);
+extern i32 arena_pool_class(i64 size);
+extern void arena_pool_lock();
+extern void arena_pool_unlock();
+extern MArena tl_arena(i32 initial_size, const char *name);
+extern void arena_pool_release(BlockAllocatorState *state);
 extern AllocatorInfo get_allocator_info(Allocator alloc);
+extern void mem_allocators_lock_acquire();
+extern void mem_allocators_lock_release();
+extern AllocatorNode *register_allocator(Allocator alloc, const char *name);
+extern void unregister_allocator(AllocatorNode *node);
+extern i32 get_allocator_snapshots(AllocatorSnapshot *dst, i32 max_count);
+extern void log_allocator_report();
 extern void restore_arena(MArena *arena);
 extern void release_arena(MArena *arena);
 extern void *align_ptr(void *ptr, u8 alignment, u8 header_size);
+extern i64 arena_commit_size(u32 flags);
+extern void arena_commit(u8 **committed, u8 *end, u8 *required, u32 flags);
+extern void arena_decommit(u8 **committed, u8 *current, u32 flags);
+extern void arena_debug_mark(ArenaDebugHeader *header, i64 size);
+extern void arena_debug_check(ArenaDebugHeader *header);
+extern ArenaDebugHeader *arena_debug_reset(ArenaDebugHeader *last, u8 *restore, u8 *current, bool ordered);
 extern void *tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern void linear_commit(LinearAllocatorState *state, u8 *required);
+extern u8 *linear_bump(LinearAllocatorState *state, i64 size, u8 alignment);
+extern bool linear_extend_inplace(LinearAllocatorState *state, const void *old_ptr, i64 old_size, i64 size);
 extern void *linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern void malloc_track(i64 delta, i64 alloc_count);
+extern i64 *malloc_large_mapping(const void *ptr);
+extern i64 malloc_large_size(i64 size, u8 alignment);
+extern void *malloc_large_alloc(i64 size, u8 alignment);
+extern void *malloc_large_realloc(const void *ptr, i64 size, bool may_move);
 extern void *malloc_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
-extern Allocator tl_linear_allocator(i64 size);
-extern Allocator linear_allocator(i64 size);
+extern u8 *arena_reserve(i64 size, i64 header_size, u32 flags, u8 **committed, u32 *obtained_flags);
+extern Allocator tl_linear_allocator(i64 size, u32 flags, const char *name);
+extern Allocator linear_allocator(i64 size, u32 flags, const char *name);
+extern u8 *block_data(BlockAllocatorState::Block *block);
+extern void block_recycle(BlockAllocatorState *state, BlockAllocatorState::Block *block);
+extern BlockAllocatorState::Block *block_push(BlockAllocatorState *state, i64 size, u8 alignment);
+extern void *tl_block_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern void tl_block_allocator_destroy(BlockAllocatorState *state);
+extern Allocator tl_block_allocator(i64 block_size, Allocator backing, const char *name);
 extern Allocator malloc_allocator();
+extern void *vm_freelist_alloc_unlocked(VMFreeListState *state, i64 size, u8 alignment);
+extern void vm_freelist_free_unlocked(VMFreeListState *state, const void *ptr);
 extern void *vm_freelist_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern i32 vm_freelist_alloc_batch(VMFreeListState *state, i64 size, u8 alignment, u8 cache_class, void **out, i32 count);
+extern void vm_freelist_free_batch(VMFreeListState *state, void **ptrs, i32 count);
+extern i64 tl_cache_class_size(i32 cache_class);
+extern i32 tl_cache_class_of(i64 size);
+extern TlCache *tl_cache_of(TlCacheAllocatorState *state);
+extern void *tl_cache_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern Allocator tl_cache_allocator(Allocator vm_freelist);
+extern i64 slab_class_size(i32 size_class);
+extern i32 slab_class_of(i64 size, u8 alignment);
+extern i64 slab_first_object_offset(i32 size_class);
+extern i64 slab_class_capacity(i32 size_class);
+extern i32 slab_run_bin(i64 run_size);
+extern SlabAllocatorState::Slab *slab_of(const void *ptr);
+extern SlabAllocatorState::Slab *slab_acquire_run(SlabAllocatorState *state, i32 bin);
+extern void slab_release_run(SlabAllocatorState *state, SlabAllocatorState::Slab *run);
+extern void slab_push_partial(SlabAllocatorState::SizeClass *sc, SlabAllocatorState::Slab *slab);
+extern void slab_remove_partial(SlabAllocatorState::SizeClass *sc, SlabAllocatorState::Slab *slab);
+extern bool slab_is_full(SlabAllocatorState::Slab *slab);
+extern bool slab_fits(const void *ptr, i64 size, u8 alignment);
+extern void *slab_alloc_small(SlabAllocatorState *state, i32 size_class);
+extern void slab_free_small(SlabAllocatorState *state, SlabAllocatorState::Slab *slab, const void *ptr);
+extern void *slab_alloc_large(SlabAllocatorState *state, i64 size);
+extern void slab_free_large(SlabAllocatorState *state, SlabAllocatorState::Slab *run);
+extern void *slab_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern Allocator slab_allocator(i64 max_size);
+extern SlabAllocatorInfo get_slab_allocator_info(Allocator slab);
+extern TrackedCallsite *tracking_callsite(TrackingAllocatorState *state, MemCallsite callsite);
+extern void tracking_add(TrackingAllocatorState *state, TrackedCallsite *site, i64 size);
+extern void tracking_remove(TrackingAllocatorState *state, TrackedCallsite *site, i64 size);
+extern u32 tracking_header_size(u8 alignment);
+extern void *tracking_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+extern Allocator tracking_allocator(Allocator backing);
+extern i32 get_tracked_callsites(Allocator tracking, TrackedCallsite *dst, i32 max_count);
+extern void log_tracking_report(Allocator tracking, i32 max_callsites);
 
 #endif // MEMORY_GENERATED_H
 
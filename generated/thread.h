@@ -5,7 +5,10 @@ extern Mutex *create_mutex();
 extern void lock_mutex(Mutex *);
 extern void unlock_mutex(Mutex *);
 extern Thread *create_thread(ThreadProc proc, void *user_data);
+extern i32 join_thread(Thread *thread);
+extern void yield_thread();
 extern i32 thread_id();
+extern i32 hardware_thread_count();
 
 #endif // THREAD_GENERATED_H
 
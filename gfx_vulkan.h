@@ -375,7 +375,7 @@ extern struct GfxVkContext {
     DynamicArray<GfxVkTextureDesc>    texture_descs;
     DynamicMap<GfxTextureAssetDesc, GfxTexture>  texture_asset_map;
 
-    DynamicMap<GfxSampler, VkSampler> samplers;
+    SwissMap<GfxSampler, VkSampler> samplers;
 
     DynamicArray<GfxVkBuffer> buffers;
 
@@ -386,12 +386,12 @@ extern struct GfxVkContext {
     DynamicMap<AssetHandle,   i32> material_asset_map;
 
     DynamicArray<GfxVkShader> shaders;
-    DynamicMap<GfxShader, DynamicArray<GfxPipelineIdx>> shaders_used_by;
+    DynamicMap<GfxShader, SmallArray<GfxPipelineIdx, 4>> shaders_used_by;
 
     VkDescriptorPool descriptor_pool;
     DynamicArray<VkDescriptorPool> descriptor_pools;
     DynamicMap<VkDescriptorSetLayoutCreateInfo, VkDescriptorSetLayout> descriptor_layouts;
-    DynamicMap<GfxVkDescriptorSetDesc, VkDescriptorSet> descriptor_sets;
+    SwissMap<GfxVkDescriptorSetDesc, VkDescriptorSet> descriptor_sets;
 
     DynamicMap<GfxPrimitiveDesc, GfxMesh> primitives;
 
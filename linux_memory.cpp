@@ -3,16 +3,186 @@
 #include "thread.h"
 
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <errno.h>
 
+i32 get_page_size()
+{
+    return getpagesize();
+}
+
+// NOTE(jesper): the NUMA policy syscalls are invoked directly rather than
+// through libnuma to not take a dependency on it. MPOL_PREFERRED falls back to
+// other nodes when the preferred node is out of memory, instead of failing the
+// page fault like MPOL_BIND would
+#define M_MPOL_PREFERRED 1
+#define M_MPOL_F_ADDR    (1 << 1)
+#define M_NUMA_MAX_NODES 64
+
+i32 current_numa_node()
+{
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return -1;
+    return (i32)node;
+}
+
+bool virtual_bind_numa_node(void *addr, i64 size, i32 node)
+{
+    if (node < 0 || node >= M_NUMA_MAX_NODES) return false;
+
+    unsigned long nodemask = 1UL << node;
+    if (syscall(SYS_mbind, addr, size, M_MPOL_PREFERRED, &nodemask, M_NUMA_MAX_NODES+1, 0) != 0) {
+        LOG_INFO("failed to bind %lld bytes at [%p] to numa node %d, errno: %d", size, addr, node, errno);
+        return false;
+    }
+
+    return true;
+}
+
+i32 virtual_numa_node(void *addr)
+{
+    int mode;
+    unsigned long nodemask = 0;
+    if (syscall(SYS_get_mempolicy, &mode, &nodemask, M_NUMA_MAX_NODES+1, addr, M_MPOL_F_ADDR) != 0) return -1;
+    if (mode != M_MPOL_PREFERRED || nodemask == 0) return -1;
+    return __builtin_ctzl(nodemask);
+}
+
+void* virtual_reserve_pages(i64 size, u32 flags, u32 *obtained_flags)
+{
+    if (flags & M_HUGE_PAGES_EXPLICIT) {
+        // NOTE(jesper): MAP_HUGETLB pages come out of the pre-allocated huge
+        // page pool, so the mapping is committed up-front and fails if the pool
+        // can't cover it
+        i64 huge_size = (size + M_HUGE_PAGE_SIZE-1) & ~(i64)(M_HUGE_PAGE_SIZE-1);
+        void *mem = mmap(
+            nullptr, huge_size,
+            PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,
+            -1, 0);
+
+        if (mem != MAP_FAILED) {
+            *obtained_flags |= M_HUGE_PAGES_EXPLICIT;
+            return mem;
+        }
+
+        LOG_INFO("failed to map %lld bytes of huge pages, errno: %d, falling back to transparent huge pages", huge_size, errno);
+    }
+
+    bool huge_pages = flags & (M_HUGE_PAGES|M_HUGE_PAGES_EXPLICIT);
+    i64 reserve_size = huge_pages ? size + M_HUGE_PAGE_SIZE : size;
+
+    void *mem = mmap(
+        nullptr, reserve_size,
+        PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,
+        -1, 0);
+
+    if (mem == MAP_FAILED) {
+        LOG_ERROR("failed to reserve %lld bytes of virtual memory, errno: %d", size, errno);
+        return nullptr;
+    }
+
+    if (huge_pages) {
+        // NOTE(jesper): transparent huge pages are only used for huge page
+        // aligned ranges, so trim the over-reserved range to an aligned one
+        u8 *aligned = (u8*)(((size_t)mem + M_HUGE_PAGE_SIZE-1) & ~(size_t)(M_HUGE_PAGE_SIZE-1));
+        i64 head = aligned - (u8*)mem;
+        i64 tail = reserve_size - head - size;
+
+        if (head > 0) munmap(mem, head);
+        if (tail > 0) munmap(aligned + size, tail);
+        mem = aligned;
+
+        if (madvise(mem, size, MADV_HUGEPAGE) == 0) {
+            *obtained_flags |= M_HUGE_PAGES;
+        } else {
+            LOG_INFO("transparent huge pages unavailable for %lld bytes, errno: %d", size, errno);
+        }
+    }
+
+    return mem;
+}
+
+void* virtual_reserve(i64 size, u32 flags, u32 *obtained_flags, i32 *numa_node)
+{
+    u32 obtained = 0;
+    void *mem = virtual_reserve_pages(size, flags, &obtained);
+
+    // NOTE(jesper): the policy applies to pages as they are faulted in, so
+    // binding the reserved range up-front covers every later commit
+    i32 bound_node = -1;
+    if (mem && (flags & M_NUMA_LOCAL)) {
+        i32 node = current_numa_node();
+        if (virtual_bind_numa_node(mem, size, node)) {
+            obtained |= M_NUMA_LOCAL;
+            bound_node = node;
+        }
+    }
+
+    if (obtained_flags) *obtained_flags = obtained;
+    if (numa_node) *numa_node = bound_node;
+    return mem;
+}
+
 void* virtual_commit(void *addr, i64 size)
 {
-	(void)size;
-	return addr;
+    if (mprotect(addr, size, PROT_READ|PROT_WRITE) != 0) {
+        LOG_ERROR("failed to commit %lld bytes at [%p], errno: %d", size, addr, errno);
+        return nullptr;
+    }
+
+    return addr;
+}
+
+void virtual_decommit(void *addr, i64 size)
+{
+    // NOTE(jesper): MADV_DONTNEED drops the pages so that they no longer count
+    // towards RSS, and they read back as zero when committed again
+    if (madvise(addr, size, MADV_DONTNEED) != 0) {
+        LOG_ERROR("failed to decommit %lld bytes at [%p], errno: %d", size, addr, errno);
+    }
+
+    if (mprotect(addr, size, PROT_NONE) != 0) {
+        LOG_ERROR("failed to protect %lld decommitted bytes at [%p], errno: %d", size, addr, errno);
+    }
+}
+
+void* virtual_map(i64 size)
+{
+    void *mem = mmap(
+        nullptr, size,
+        PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
+        -1, 0);
+
+    if (mem == MAP_FAILED) {
+        LOG_ERROR("failed to map %lld bytes of memory, errno: %d", size, errno);
+        return nullptr;
+    }
+
+    return mem;
+}
+
+void* virtual_remap(void *addr, i64 old_size, i64 size, bool may_move)
+{
+    // NOTE(jesper): mremap moves the page table entries of the mapping, the
+    // contents are never copied
+    void *mem = mremap(addr, old_size, size, may_move ? MREMAP_MAYMOVE : 0);
+    if (mem == MAP_FAILED) {
+        if (may_move) LOG_ERROR("failed to remap %lld bytes at [%p] to %lld bytes, errno: %d", old_size, addr, size, errno);
+        return nullptr;
+    }
+
+    return mem;
 }
 
-Allocator vm_freelist_allocator(i64 max_size)
+void virtual_unmap(void *addr, i64 size)
+{
+    if (munmap(addr, size) != 0) {
+        LOG_ERROR("failed to unmap %lld bytes at [%p], errno: %d", size, addr, errno);
+    }
+}
+
+Allocator vm_freelist_allocator(i64 max_size, u32 flags, const char *name)
 {
     extern void* vm_freelist_alloc(
         void *v_state,
@@ -23,12 +193,16 @@ Allocator vm_freelist_allocator(i64 max_size)
         u8 alignment);
 
 	int page_size = getpagesize();
-    i64 reserve_size = ROUND_TO(max_size, page_size);
-    void *mem = mmap(
-        nullptr, reserve_size,
-        PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS,
-        0, 0);
-    PANIC_IF(mem == MAP_FAILED, "failed to mmap, errno: %d", errno);
+    bool huge_pages = flags & (M_HUGE_PAGES|M_HUGE_PAGES_EXPLICIT);
+    i64 reserve_size = ROUND_TO(max_size, huge_pages ? M_HUGE_PAGE_SIZE : page_size);
+
+    u32 obtained_flags;
+    i32 numa_node;
+    void *mem = virtual_reserve(reserve_size, flags, &obtained_flags, &numa_node);
+    PANIC_IF(!mem, "failed to reserve memory for vm_freelist_allocator");
+
+    // NOTE(jesper): commit in huge page units to not split them up
+    if (obtained_flags & (M_HUGE_PAGES|M_HUGE_PAGES_EXPLICIT)) page_size = M_HUGE_PAGE_SIZE;
 
     VMFreeListState *state = (VMFreeListState *)malloc(sizeof *state);
     *state = {
@@ -38,7 +212,11 @@ Allocator vm_freelist_allocator(i64 max_size)
         .free_block = nullptr,
         .mutex = create_mutex(),
         .page_size = page_size,
+        .flags = obtained_flags,
+        .numa_node = numa_node,
     };
 
-    return Allocator{ state, vm_freelist_alloc };
+    Allocator alloc{ state, vm_freelist_alloc };
+    register_allocator(alloc, name);
+    return alloc;
 }
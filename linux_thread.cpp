@@ -3,6 +3,7 @@
 #include "memory.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 #include <unistd.h>
 
@@ -10,6 +11,7 @@ struct Thread {
 	pthread_t handle;
 	ThreadProc user_proc;
 	void *user_data;
+	i32 result;
 };
 
 Mutex* create_mutex()
@@ -57,15 +59,39 @@ Thread* create_thread(ThreadProc proc, void *user_data)
 	[](void *data) -> void*
 	{
 		Thread *thread = (Thread*)data;
-		thread->user_proc(thread->user_data);
+		thread->result = thread->user_proc(thread->user_data);
 		return nullptr;
 	}, thread);
 
+	pthread_attr_destroy(&attr);
 	PANIC_IF(result != 0, "failed creating thread");
 	return thread;
 }
 
+i32 join_thread(Thread *thread)
+{
+    extern Allocator mem_sys;
+
+	int r = pthread_join(thread->handle, nullptr);
+	PANIC_IF(r != 0, "failed to join thread, errno: %d", r);
+
+	i32 result = thread->result;
+	FREE(mem_sys, thread);
+	return result;
+}
+
+void yield_thread()
+{
+    sched_yield();
+}
+
 i32 thread_id() 
 {
     return (i32)gettid();
 }
+
+i32 hardware_thread_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (i32)count : 1;
+}
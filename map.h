@@ -3,17 +3,56 @@
 
 #include "core.h"
 #include "memory.h"
+#include "array.h"
 #include "hash.h"
+#include "thread.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define MAP_SSE2 1
+#endif
 
 #define DYNAMIC_MAP_INNITIAL_CAPACITY 16
-#define DYNAMIC_MAP_LOAD_FACTOR 0.5
+#define DYNAMIC_MAP_LOAD_FACTOR 0.875
+
+#define SWISS_MAP_GROUP_SIZE 16
+#define SWISS_MAP_LOAD_FACTOR 0.875
+
+#define CONCURRENT_MAP_STRIPE_BITS 4
+#define CONCURRENT_MAP_STRIPES (1 << CONCURRENT_MAP_STRIPE_BITS)
+#define CONCURRENT_MAP_LOCK_WRITER (1 << 30)
+#define CONCURRENT_MAP_LOCK_WRITER_PENDING (1 << 29)
+
+// NOTE(jesper): specialise to store each key's 32-bit hash in its slot. A
+// rehash then never has to hash the keys again, and a probe only compares keys
+// whose hashes match, which pays off for keys that are expensive to hash or
+// compare, like strings
+template<typename K>
+struct MapCachesHash { static constexpr bool value = false; };
+
+template<>
+struct MapCachesHash<String> { static constexpr bool value = true; };
+
+template<typename K, bool cached = MapCachesHash<K>::value>
+struct MapSlotHash {};
+
+template<typename K>
+struct MapSlotHash<K, true> { u32 hash; };
 
+// NOTE(jesper): linear probing map with Robin Hood displacement. Each slot
+// stores its entry's probe distance from its home slot, plus one so that 0
+// marks an empty slot, and entries in a cluster are kept ordered by distance:
+// an insert takes the place of the first entry that is closer to its home
+// than the new key would be, shifting the rest of the cluster one slot along.
+// A lookup can give up as soon as it passes a slot with a shorter distance
+// than its own, which bounds misses by the longest cluster instead of the
+// table, and keeps probes short enough to run at a high load factor
 template<typename K, typename V>
 struct DynamicMap {
-    struct Pair {
+    struct Pair : MapSlotHash<K> {
         K key;
         V value;
-        bool occupied;
+        i32 dist;
 
         V* operator->() { return &value; }
 
@@ -28,7 +67,7 @@ struct DynamicMap {
         Iterator operator++()
         {
             slot++;
-            while (slot < table->capacity && !table->slots[slot].occupied) slot++;
+            while (slot < table->capacity && table->slots[slot].dist == 0) slot++;
             return *this;
         }
 
@@ -46,7 +85,7 @@ struct DynamicMap {
     Iterator begin()
     {
         Iterator it = { this, 0 };
-        while (it.slot < capacity && !slots[it.slot].occupied) it.slot++;
+        while (it.slot < capacity && slots[it.slot].dist == 0) it.slot++;
         return it;
     }
 
@@ -72,7 +111,7 @@ void map_reset(DynamicMap<String, V> *map, Allocator mem)
     PANIC_IF(map->alloc != mem, "mismatching allocators");
 
     for (i32 i = 0; i  < map->capacity; i++) {
-        if (!map->slots[i].occupied) continue;
+        if (map->slots[i].dist == 0) continue;
         FREE(map->alloc, map->slots[i].key.data);
     }
 
@@ -85,114 +124,222 @@ template<typename K, typename V>
 void map_set(DynamicMap<K, V> *map, const K &key, const V &value);
 
 template<typename K, typename V>
-i32 map_find_slot(DynamicMap<K, V> *map, const K &key)
+u32 map_slot_hash(DynamicMap<K, V> *map, i32 slot)
+{
+    if constexpr (MapCachesHash<K>::value) return map->slots[slot].hash;
+    else return hash32(map->slots[slot].key);
+}
+
+template<typename K, typename V>
+i32 map_find_slot(DynamicMap<K, V> *map, const K &key, u32 hash)
 {
-    // TODO(jesper): round robin to reduce the upper bound of the probing
     if (map->capacity == 0) return -1;
-    i32 i = hash32(key) % map->capacity;
-    i32 end_probe = i;
-    while (map->slots[i].occupied && map->slots[i].key != key) {
-        i = (i+1) % map->capacity;
-        if (i == end_probe) return -1;
+
+    i32 mask = map->capacity-1;
+    i32 i = hash & mask;
+    for (i32 dist = 1; map->slots[i].dist >= dist; dist++) {
+        if (map->slots[i].dist == dist) {
+            // NOTE(jesper): keys are compared with !=, some key types only define that
+            if constexpr (MapCachesHash<K>::value) {
+                if (map->slots[i].hash == hash && !(map->slots[i].key != key)) return i;
+            } else {
+                if (!(map->slots[i].key != key)) return i;
+            }
+        }
+        i = (i+1) & mask;
     }
 
-    return i;
+    return -1;
 }
 
 template<typename K, typename V>
-void map_grow(DynamicMap<K, V> *map, i32 new_capacity)
+i32 map_find_slot(DynamicMap<K, V> *map, const K &key)
 {
-    //LOG_INFO("[map][%p] grow: %d -> %d", map, map->capacity, new_capacity);
-    ASSERT(new_capacity > map->capacity);
+    return map_find_slot(map, key, hash32(key));
+}
+
+template<typename K, typename V>
+i32 map_place_slot(DynamicMap<K, V> *map, u32 hash);
+
+template<typename K, typename V>
+void map_rehash(DynamicMap<K, V> *map, i32 new_capacity)
+{
+    //LOG_INFO("[map][%p] rehash: %d -> %d", map, map->capacity, new_capacity);
+    ASSERT((new_capacity & (new_capacity-1)) == 0);
+    ASSERT(map->count < new_capacity*DYNAMIC_MAP_LOAD_FACTOR);
     if (map->alloc.proc == nullptr) map->alloc = mem_dynamic;
 
     using Pair = typename DynamicMap<K,V>::Pair;
     DynamicMap<K, V> old_table = *map;
 
     map->slots = ALLOC_ARR(map->alloc, Pair, new_capacity);
-    for (i32 i = 0; i < new_capacity; i++) map->slots[i].occupied = false;
+    for (i32 i = 0; i < new_capacity; i++) map->slots[i].dist = 0;
     map->capacity = new_capacity;
     map->count = 0;
 
     for (i32 i = 0; i < old_table.capacity; i++) {
-        if (!old_table.slots[i].occupied) continue;
-        map_set(map, old_table.slots[i].key, old_table.slots[i].value);
+        if (old_table.slots[i].dist == 0) continue;
+
+        u32 hash = map_slot_hash(&old_table, i);
+        i32 slot = map_place_slot(map, hash);
+
+        i32 dist = map->slots[slot].dist;
+        new (&map->slots[slot]) Pair(RMOV(old_table.slots[i]));
+        map->slots[slot].dist = dist;
+        old_table.slots[i].~Pair();
     }
 
     if (old_table.slots) FREE(map->alloc, old_table.slots);
 }
 
 template<typename K, typename V>
-i32 map_set_slot(DynamicMap<K, V> *map, i32 slot, const K &key, const V &value)
+void map_grow(DynamicMap<K, V> *map, i32 new_capacity)
+{
+    ASSERT(new_capacity > map->capacity);
+
+    i32 capacity = DYNAMIC_MAP_INNITIAL_CAPACITY;
+    while (capacity < new_capacity) capacity *= 2;
+    map_rehash(map, capacity);
+}
+
+// NOTE(jesper): shrinks the map to the smallest capacity that holds its
+// entries under the load factor. Removal never leaves tombstones behind, so
+// this is only needed to give memory back after a map has emptied out
+template<typename K, typename V>
+void map_compact(DynamicMap<K, V> *map)
+{
+    if (map->count == 0) {
+        if (map->slots) FREE(map->alloc, map->slots);
+        map->slots = nullptr;
+        map->capacity = 0;
+        return;
+    }
+
+    i32 new_capacity = DYNAMIC_MAP_INNITIAL_CAPACITY;
+    while (map->count >= new_capacity*DYNAMIC_MAP_LOAD_FACTOR) new_capacity *= 2;
+    if (new_capacity < map->capacity) map_rehash(map, new_capacity);
+}
+
+// NOTE(jesper): returns the slot a key with the given hash, that is not in the
+// map, goes into after shifting the entries that follow it in the cluster one
+// slot along. The returned slot holds no live key or value and has its dist
+// and cached hash set, the caller constructs the key and value in place
+template<typename K, typename V>
+i32 map_place_slot(DynamicMap<K, V> *map, u32 hash)
+{
+    using Pair = typename DynamicMap<K,V>::Pair;
+
+    i32 mask = map->capacity-1;
+    i32 slot = hash & mask;
+    i32 dist = 1;
+    while (map->slots[slot].dist >= dist) {
+        slot = (slot+1) & mask;
+        dist++;
+    }
+
+    i32 empty = slot;
+    while (map->slots[empty].dist != 0) empty = (empty+1) & mask;
+
+    if (empty != slot) {
+        i32 prev = (empty-1) & mask;
+        new (&map->slots[empty]) Pair(RMOV(map->slots[prev]));
+        map->slots[empty].dist++;
+
+        for (i32 i = prev; i != slot; i = prev) {
+            prev = (i-1) & mask;
+            map->slots[i] = RMOV(map->slots[prev]);
+            map->slots[i].dist++;
+        }
+
+        map->slots[slot].~Pair();
+    }
+
+    map->slots[slot].dist = dist;
+    if constexpr (MapCachesHash<K>::value) map->slots[slot].hash = hash;
+    map->count++;
+    return slot;
+}
+
+template<typename K, typename V>
+i32 map_insert_slot(DynamicMap<K, V> *map, u32 hash)
 {
     if (map->count >= map->capacity*DYNAMIC_MAP_LOAD_FACTOR) {
         i32 new_capacity = map->capacity == 0 ? DYNAMIC_MAP_INNITIAL_CAPACITY : map->capacity*2;
-        map_grow(map, new_capacity);
-
-        slot = map_find_slot(map, key);
-        ASSERT(slot >= 0);
+        map_rehash(map, new_capacity);
     }
 
+    return map_place_slot(map, hash);
+}
+
+template<typename K, typename V>
+i32 map_set_slot(DynamicMap<K, V> *map, const K &key, const V &value, u32 hash)
+{
+    i32 slot = map_insert_slot(map, hash);
+
     //LOG_INFO("[map][%p] set slot[%d]", map, slot);
-    map->slots[slot].occupied = true;
     new (&map->slots[slot].value) V(value);
     new (&map->slots[slot].key) K(key);
-    map->count++;
-
     return slot;
 }
 
 template<typename K, typename V, i32 n>
-i32 map_set_slot(DynamicMap<K, V[n]> *map, i32 slot, const K &key, const V (&value)[n])
+i32 map_set_slot(DynamicMap<K, V[n]> *map, const K &key, const V (&value)[n], u32 hash)
 {
-    if (map->count >= map->capacity*DYNAMIC_MAP_LOAD_FACTOR) {
-        i32 new_capacity = map->capacity == 0 ? DYNAMIC_MAP_INNITIAL_CAPACITY : map->capacity*2;
-        map_grow(map, new_capacity);
-
-        slot = map_find_slot(map, key);
-        ASSERT(slot >= 0);
-    }
+    i32 slot = map_insert_slot(map, hash);
 
     //LOG_INFO("[map][%p] set slot[%d]", map, slot);
-    map->slots[slot].occupied = true;
     new (&map->slots[slot].key) K(key);
     for (i32 i = 0; i < n; i++) new (&map->slots[slot].value[i]) V(value[i]);
-    map->count++;
-
     return slot;
 }
 
 template<typename K, typename V>
 void map_set(DynamicMap<K, V> *map, const K &key, const V &value)
 {
-    i32 slot = map_find_slot(map, key);
-    if (slot >= 0 && map->slots[slot].occupied) {
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot >= 0) {
         //LOG_INFO("[map] set slot[%d]", slot);
         map->slots[slot].value = value;
         return;
     }
 
-    map_set_slot(map, slot, key, value);
+    map_set_slot(map, key, value, hash);
 }
 
 template<typename K, typename V, i32 n>
 void map_set(DynamicMap<K, V[n]> *map, const K &key, const V (&value)[n])
 {
-    i32 slot = map_find_slot(map, key);
-    if (slot >= 0 && map->slots[slot].occupied) {
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot >= 0) {
         for (i32 i = 0; i < n; i++) map->slots[slot].value[i] = value[i];
         return;
     }
 
-    map_set_slot(map, slot, key, value);
+    map_set_slot(map, key, value, hash);
 }
 
 template<typename K, typename V>
 void map_remove(DynamicMap<K, V> *map, const K &key)
 {
     i32 slot = map_find_slot(map, key);
-    if (slot == -1 || !map->slots[slot].occupied) return;
-    map->slots[slot].occupied = false;
+    if (slot == -1) return;
+
+    // NOTE(jesper): backward shift deletion. Every entry after the removed one
+    // that is away from its home slot moves one slot back, until the cluster
+    // ends or reaches an entry already in its home slot. This keeps the
+    // cluster ordered by distance without leaving any tombstones behind
+    i32 mask = map->capacity-1;
+    i32 hole = slot;
+    for (i32 i = (hole+1) & mask; map->slots[i].dist > 1; i = (i+1) & mask) {
+        map->slots[hole] = RMOV(map->slots[i]);
+        map->slots[hole].dist--;
+        hole = i;
+    }
+
+    map->slots[hole].~Pair();
+    map->slots[hole].dist = 0;
     map->count--;
 }
 
@@ -200,7 +347,7 @@ template<typename K, typename V>
 V* map_find(DynamicMap<K, V> *map, const K &key)
 {
     i32 i = map_find_slot(map, key);
-    if (i == -1 || !map->slots[i].occupied) return nullptr;
+    if (i == -1) return nullptr;
     return &map->slots[i].value;
 }
 
@@ -208,30 +355,28 @@ template<typename K, typename V, i32 n>
 V* map_find(DynamicMap<K, V[n]> *map, const K &key)
 {
     i32 i = map_find_slot(map, key);
-    if (i == -1 || !map->slots[i].occupied) return nullptr;
+    if (i == -1) return nullptr;
     return &map->slots[i].value[0];
 }
 
 template<typename K, typename V>
 V* map_find_emplace(DynamicMap<K, V> *map, const K &key)
 {
-    i32 slot = map_find_slot(map, key);
-
-    if (slot == -1 || !map->slots[slot].occupied) {
-        slot = map_set_slot(map, slot, key, V{});
-    }
-
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot == -1) slot = map_set_slot(map, key, V{}, hash);
     return &map->slots[slot].value;
 }
 
 template<typename K, typename V, i32 n>
 V* map_find_emplace(DynamicMap<K, V[n]> *map, const K &key)
 {
-    i32 slot = map_find_slot(map, key);
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
 
-    if (slot == -1 || !map->slots[slot].occupied) {
+    if (slot == -1) {
         V value[n] = {};
-        slot = map_set_slot(map, slot, key, value);
+        slot = map_set_slot(map, key, value, hash);
     }
 
     return &map->slots[slot].value[0];
@@ -240,12 +385,9 @@ V* map_find_emplace(DynamicMap<K, V[n]> *map, const K &key)
 template<typename K, typename V>
 V* map_find_emplace(DynamicMap<K, V> *map, const K &key, const V &emp_value)
 {
-    i32 slot = map_find_slot(map, key);
-
-    if (slot == -1 || !map->slots[slot].occupied) {
-        slot = map_set_slot(map, slot, key, emp_value);
-    }
-
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot == -1) slot = map_set_slot(map, key, emp_value, hash);
     return &map->slots[slot].value;
 }
 
@@ -258,8 +400,667 @@ template<typename V>
 V* map_find(DynamicMap<String, V> *map, String key)
 {
     i32 i = map_find_slot(map, key);
-    if (i == -1 || !map->slots[i].occupied) return nullptr;
+    if (i == -1) return nullptr;
     return &map->slots[i].value;
 }
 
+
+// NOTE(jesper): open addressing map with the slots' occupancy kept in a
+// separate array of control bytes. A full slot's control byte holds the low 7
+// bits of its key's hash, so a probe compares the hash fragments of a group of
+// SWISS_MAP_GROUP_SIZE slots at once and only compares keys on a fragment
+// match. The capacity is always a power of two number of groups, groups are
+// probed quadratically, and a probe ends at the first group with an empty slot
+enum SwissMapCtrl : i8 {
+    SWISS_MAP_EMPTY   = (i8)0x80,
+    SWISS_MAP_DELETED = (i8)0xfe,
+};
+
+template<typename K, typename V>
+struct SwissMap {
+    struct Pair {
+        K key;
+        V value;
+
+        V* operator->() { return &value; }
+
+        operator V&() { return value; }
+        operator V*() { return &value; }
+    };
+
+    struct Iterator {
+        SwissMap *table;
+        i32 slot;
+
+        Iterator operator++()
+        {
+            slot++;
+            while (slot < table->capacity && table->ctrl[slot] < 0) slot++;
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) { return slot != other.slot; }
+
+        Pair& operator*() { return table->slots[slot]; }
+        Pair* operator->() { return &table->slots[slot]; }
+    };
+
+    i8 *ctrl = nullptr;
+    Pair *slots = nullptr;
+    i32 count = 0;
+    i32 deleted = 0;
+    i32 capacity = 0;
+    Allocator alloc = {};
+
+    Iterator begin()
+    {
+        Iterator it = { this, 0 };
+        while (it.slot < capacity && ctrl[it.slot] < 0) it.slot++;
+        return it;
+    }
+
+    Iterator end()
+    {
+        Iterator it = { this, capacity };
+        return it;
+    }
+};
+
+// NOTE(jesper): bit i of the result is set if ctrl byte i of the group matches
+inline u32 swiss_map_match(const i8 *group, i8 h2)
+{
+#if MAP_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+    u32 mask = 0;
+    for (i32 i = 0; i < SWISS_MAP_GROUP_SIZE; i++) mask |= (u32)(group[i] == h2) << i;
+    return mask;
+#endif
+}
+
+// NOTE(jesper): empty and deleted are the only control bytes with the high bit set
+inline u32 swiss_map_match_free(const i8 *group)
+{
+#if MAP_SSE2
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    u32 mask = 0;
+    for (i32 i = 0; i < SWISS_MAP_GROUP_SIZE; i++) mask |= (u32)(group[i] < 0) << i;
+    return mask;
+#endif
+}
+
+inline u32 swiss_map_match_empty(const i8 *group)
+{
+    return swiss_map_match(group, SWISS_MAP_EMPTY);
+}
+
+template<typename K, typename V>
+i32 map_find_slot(SwissMap<K, V> *map, const K &key, u32 hash)
+{
+    if (map->capacity == 0) return -1;
+
+    i8 h2 = (i8)(hash & 0x7f);
+    i32 group_mask = map->capacity/SWISS_MAP_GROUP_SIZE - 1;
+    i32 group = (i32)(hash >> 7) & group_mask;
+
+    for (i32 step = 1; ; step++) {
+        i8 *ctrl = map->ctrl + group*SWISS_MAP_GROUP_SIZE;
+        for (u32 match = swiss_map_match(ctrl, h2); match; match &= match-1) {
+            i32 slot = group*SWISS_MAP_GROUP_SIZE + __builtin_ctz(match);
+            // NOTE(jesper): compared with != like DynamicMap, some key types only define that
+            if (!(map->slots[slot].key != key)) return slot;
+        }
+
+        if (swiss_map_match_empty(ctrl) || step > group_mask) return -1;
+        group = (group + step) & group_mask;
+    }
+}
+
+template<typename K, typename V>
+i32 map_find_free_slot(SwissMap<K, V> *map, u32 hash)
+{
+    i32 group_mask = map->capacity/SWISS_MAP_GROUP_SIZE - 1;
+    i32 group = (i32)(hash >> 7) & group_mask;
+
+    for (i32 step = 1; ; step++) {
+        u32 match = swiss_map_match_free(map->ctrl + group*SWISS_MAP_GROUP_SIZE);
+        if (match) return group*SWISS_MAP_GROUP_SIZE + __builtin_ctz(match);
+        group = (group + step) & group_mask;
+    }
+}
+
+template<typename K, typename V>
+void map_rehash(SwissMap<K, V> *map, i32 new_capacity)
+{
+    ASSERT(new_capacity >= SWISS_MAP_GROUP_SIZE && (new_capacity & (new_capacity-1)) == 0);
+    ASSERT(map->count < new_capacity*SWISS_MAP_LOAD_FACTOR);
+    if (map->alloc.proc == nullptr) map->alloc = mem_dynamic;
+
+    using Pair = typename SwissMap<K, V>::Pair;
+    SwissMap<K, V> old_table = *map;
+
+    i64 ctrl_size = (new_capacity + alignof(Pair)-1) & ~(i64)(alignof(Pair)-1);
+    u8 *mem = (u8*)ALLOC_A(map->alloc, ctrl_size + new_capacity*sizeof(Pair), MAX(alignof(Pair), 16));
+
+    map->ctrl = (i8*)mem;
+    map->slots = (Pair*)(mem + ctrl_size);
+    map->capacity = new_capacity;
+    map->deleted = 0;
+    memset(map->ctrl, SWISS_MAP_EMPTY, new_capacity);
+
+    for (i32 i = 0; i < old_table.capacity; i++) {
+        if (old_table.ctrl[i] < 0) continue;
+
+        Pair *src = &old_table.slots[i];
+        u32 hash = hash32(src->key);
+        i32 slot = map_find_free_slot(map, hash);
+
+        map->ctrl[slot] = (i8)(hash & 0x7f);
+        new (&map->slots[slot].key) K(RMOV(src->key));
+        new (&map->slots[slot].value) V(RMOV(src->value));
+        src->key.~K();
+        src->value.~V();
+    }
+
+    if (old_table.ctrl) FREE(map->alloc, old_table.ctrl);
+}
+
+template<typename K, typename V>
+i32 map_insert_slot(SwissMap<K, V> *map, const K &key, const V &value, u32 hash)
+{
+    if (map->count + map->deleted + 1 > map->capacity*SWISS_MAP_LOAD_FACTOR) {
+        // NOTE(jesper): if the table is mostly full of deleted slots, rehashing
+        // at the same capacity reclaims them. The threshold leaves enough room
+        // below the load factor for the rehash to be amortised over the inserts
+        i32 new_capacity = DYNAMIC_MAP_INNITIAL_CAPACITY;
+        if (map->capacity > 0) {
+            new_capacity = (i64)map->count*32 <= (i64)map->capacity*25
+                ? map->capacity
+                : map->capacity*2;
+        }
+
+        map_rehash(map, new_capacity);
+    }
+
+    i32 slot = map_find_free_slot(map, hash);
+    if (map->ctrl[slot] == SWISS_MAP_DELETED) map->deleted--;
+
+    map->ctrl[slot] = (i8)(hash & 0x7f);
+    new (&map->slots[slot].key) K(key);
+    new (&map->slots[slot].value) V(value);
+    map->count++;
+
+    return slot;
+}
+
+template<typename K, typename V>
+void map_reset(SwissMap<K, V> *map)
+{
+    if (map->ctrl) FREE(map->alloc, map->ctrl);
+
+    map->ctrl = nullptr;
+    map->slots = nullptr;
+    map->count = 0;
+    map->deleted = 0;
+    map->capacity = 0;
+}
+
+template<typename K, typename V>
+void map_set(SwissMap<K, V> *map, const K &key, const V &value)
+{
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot >= 0) {
+        map->slots[slot].value = value;
+        return;
+    }
+
+    map_insert_slot(map, key, value, hash);
+}
+
+template<typename K, typename V>
+void map_remove(SwissMap<K, V> *map, const K &key)
+{
+    i32 slot = map_find_slot(map, key, hash32(key));
+    if (slot == -1) return;
+
+    map->slots[slot].key.~K();
+    map->slots[slot].value.~V();
+    map->count--;
+
+    // NOTE(jesper): a probe only continues past a group without empty slots,
+    // so if the slot's group has one the slot can be emptied outright
+    i8 *group = map->ctrl + (slot & ~(SWISS_MAP_GROUP_SIZE-1));
+    if (swiss_map_match_empty(group)) {
+        map->ctrl[slot] = SWISS_MAP_EMPTY;
+    } else {
+        map->ctrl[slot] = SWISS_MAP_DELETED;
+        map->deleted++;
+    }
+}
+
+template<typename K, typename V>
+V* map_find(SwissMap<K, V> *map, const K &key)
+{
+    i32 slot = map_find_slot(map, key, hash32(key));
+    if (slot == -1) return nullptr;
+    return &map->slots[slot].value;
+}
+
+template<typename K, typename V>
+V* map_find_emplace(SwissMap<K, V> *map, const K &key)
+{
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot == -1) slot = map_insert_slot(map, key, V{}, hash);
+    return &map->slots[slot].value;
+}
+
+template<typename K, typename V>
+V* map_find_emplace(SwissMap<K, V> *map, const K &key, const V &emp_value)
+{
+    u32 hash = hash32(key);
+    i32 slot = map_find_slot(map, key, hash);
+    if (slot == -1) slot = map_insert_slot(map, key, emp_value, hash);
+    return &map->slots[slot].value;
+}
+
+template<typename V>
+void map_set(SwissMap<String, V> *map, const char *key, V value) { return map_set(map, string(key), value); }
+
+template<typename V>
+V* map_find(SwissMap<String, V> *map, String key)
+{
+    i32 slot = map_find_slot(map, key, hash32(key));
+    if (slot == -1) return nullptr;
+    return &map->slots[slot].value;
+}
+
+
+// NOTE(jesper): hash map that can be read and written from any thread. Keys
+// are split across CONCURRENT_MAP_STRIPES DynamicMaps by the high bits of
+// their hash, each behind its own reader-writer spin lock, so readers of a
+// stripe run in parallel and writers only contend with threads touching the
+// same stripe. A stripe grows under its write lock, so no pointer into a
+// stripe is ever handed out; lookups copy the value out instead
+template<typename K, typename V>
+struct ConcurrentMap {
+    struct alignas(64) Stripe {
+        DynamicMap<K, V> map;
+        volatile i32 lock = 0;
+    };
+
+    Stripe stripes[CONCURRENT_MAP_STRIPES];
+};
+
+// NOTE(jesper): lock holds the number of readers in its low bits, with
+// CONCURRENT_MAP_LOCK_WRITER set while a writer holds it. A waiting writer sets
+// CONCURRENT_MAP_LOCK_WRITER_PENDING, which keeps new readers out until it's
+// had its turn, so a steady stream of readers on a stripe can't starve writers
+inline void map_lock_shared(volatile i32 *lock)
+{
+    for (i32 spins = 0; ; spin_wait(&spins)) {
+        i32 value = *lock;
+        if (value & (CONCURRENT_MAP_LOCK_WRITER|CONCURRENT_MAP_LOCK_WRITER_PENDING)) continue;
+        if (atomic_compare_exchange(lock, value, value+1)) return;
+    }
+}
+
+inline void map_unlock_shared(volatile i32 *lock)
+{
+    atomic_fetch_sub(lock, 1);
+}
+
+inline void map_lock_exclusive(volatile i32 *lock)
+{
+    for (i32 spins = 0; ; spin_wait(&spins)) {
+        i32 value = *lock;
+        if ((value & ~CONCURRENT_MAP_LOCK_WRITER_PENDING) == 0) {
+            // NOTE(jesper): taking the lock clears the pending bit, other
+            // waiting writers set it again on their next iteration
+            if (atomic_compare_exchange(lock, value, CONCURRENT_MAP_LOCK_WRITER)) return;
+        } else if (!(value & CONCURRENT_MAP_LOCK_WRITER_PENDING)) {
+            atomic_fetch_or(lock, CONCURRENT_MAP_LOCK_WRITER_PENDING);
+        }
+    }
+}
+
+inline void map_unlock_exclusive(volatile i32 *lock)
+{
+    atomic_fetch_and(lock, ~CONCURRENT_MAP_LOCK_WRITER);
+}
+
+template<typename K, typename V>
+typename ConcurrentMap<K, V>::Stripe* map_stripe(ConcurrentMap<K, V> *map, u32 hash)
+{
+    return &map->stripes[hash >> (32 - CONCURRENT_MAP_STRIPE_BITS)];
+}
+
+// NOTE(jesper): not thread safe, the map must not be in use on any other thread
+template<typename K, typename V>
+void map_reset(ConcurrentMap<K, V> *map)
+{
+    for (auto &it : map->stripes) {
+        if (it.map.slots) FREE(it.map.alloc, it.map.slots);
+        map_reset(&it.map);
+    }
+}
+
+template<typename K, typename V>
+i32 map_count(ConcurrentMap<K, V> *map)
+{
+    i32 count = 0;
+    for (auto &it : map->stripes) {
+        map_lock_shared(&it.lock);
+        count += it.map.count;
+        map_unlock_shared(&it.lock);
+    }
+
+    return count;
+}
+
+template<typename K, typename V>
+bool map_find(ConcurrentMap<K, V> *map, const K &key, V *dst)
+{
+    u32 hash = hash32(key);
+    auto *stripe = map_stripe(map, hash);
+
+    map_lock_shared(&stripe->lock);
+    defer { map_unlock_shared(&stripe->lock); };
+
+    i32 slot = map_find_slot(&stripe->map, key, hash);
+    if (slot == -1) return false;
+
+    *dst = stripe->map.slots[slot].value;
+    return true;
+}
+
+template<typename K, typename V>
+void map_set(ConcurrentMap<K, V> *map, const K &key, const V &value)
+{
+    u32 hash = hash32(key);
+    auto *stripe = map_stripe(map, hash);
+
+    map_lock_exclusive(&stripe->lock);
+    defer { map_unlock_exclusive(&stripe->lock); };
+
+    i32 slot = map_find_slot(&stripe->map, key, hash);
+    if (slot >= 0) stripe->map.slots[slot].value = value;
+    else map_set_slot(&stripe->map, key, value, hash);
+}
+
+// NOTE(jesper): inserts the key with value if it isn't already in the map.
+// Returns true if this call inserted it
+template<typename K, typename V>
+bool map_insert(ConcurrentMap<K, V> *map, const K &key, const V &value)
+{
+    u32 hash = hash32(key);
+    auto *stripe = map_stripe(map, hash);
+
+    map_lock_exclusive(&stripe->lock);
+    defer { map_unlock_exclusive(&stripe->lock); };
+
+    if (map_find_slot(&stripe->map, key, hash) >= 0) return false;
+    map_set_slot(&stripe->map, key, value, hash);
+    return true;
+}
+
+// NOTE(jesper): returns the key's value, inserting emp_value first if the key
+// isn't in the map. Threads racing to insert the same key all get the value of
+// whichever insert won
+template<typename K, typename V>
+V map_find_emplace(ConcurrentMap<K, V> *map, const K &key, const V &emp_value)
+{
+    u32 hash = hash32(key);
+    auto *stripe = map_stripe(map, hash);
+
+    map_lock_shared(&stripe->lock);
+    i32 slot = map_find_slot(&stripe->map, key, hash);
+    if (slot >= 0) {
+        V value = stripe->map.slots[slot].value;
+        map_unlock_shared(&stripe->lock);
+        return value;
+    }
+    map_unlock_shared(&stripe->lock);
+
+    map_lock_exclusive(&stripe->lock);
+    defer { map_unlock_exclusive(&stripe->lock); };
+
+    slot = map_find_slot(&stripe->map, key, hash);
+    if (slot == -1) slot = map_set_slot(&stripe->map, key, emp_value, hash);
+    return stripe->map.slots[slot].value;
+}
+
+template<typename K, typename V>
+void map_remove(ConcurrentMap<K, V> *map, const K &key)
+{
+    u32 hash = hash32(key);
+    auto *stripe = map_stripe(map, hash);
+
+    map_lock_exclusive(&stripe->lock);
+    defer { map_unlock_exclusive(&stripe->lock); };
+
+    map_remove(&stripe->map, key);
+}
+
+
+// NOTE(jesper): ordered map kept as two parallel sorted arrays, so that a
+// lookup is a binary search over densely packed keys and iteration walks both
+// arrays front to back in key order. Keys only need an operator<. Single
+// inserts and removals shift the tail of the arrays, so populate large maps
+// with map_set_batch, which sorts the new entries and merges them in one pass
+template<typename K, typename V>
+struct SortedMap {
+    struct Pair {
+        K &key;
+        V &value;
+    };
+
+    struct Iterator {
+        SortedMap *map;
+        i32 index;
+
+        Iterator operator++() { index++; return *this; }
+        bool operator!=(const Iterator &other) { return index != other.index; }
+
+        Pair operator*() { return { map->keys.data[index], map->values.data[index] }; }
+    };
+
+    struct Range {
+        SortedMap *map;
+        i32 first;
+        i32 last;
+
+        i32 count() { return last-first; }
+
+        Iterator begin() { return { map, first }; }
+        Iterator end() { return { map, last }; }
+    };
+
+    DynamicArray<K> keys;
+    DynamicArray<V> values;
+    Allocator alloc = {};
+
+    Iterator begin() { return { this, 0 }; }
+    Iterator end() { return { this, keys.count }; }
+};
+
+template<typename K, typename V>
+void map_reset(SortedMap<K, V> *map)
+{
+    array_reset(&map->keys);
+    array_reset(&map->values);
+}
+
+// NOTE(jesper): index of the first key that is not less than key
+template<typename K, typename V>
+i32 map_lower_bound(SortedMap<K, V> *map, const K &key)
+{
+    i32 first = 0, count = map->keys.count;
+    while (count > 0) {
+        i32 step = count / 2;
+        if (map->keys.data[first+step] < key) {
+            first += step+1;
+            count -= step+1;
+        } else {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+// NOTE(jesper): index of the first key that is greater than key
+template<typename K, typename V>
+i32 map_upper_bound(SortedMap<K, V> *map, const K &key)
+{
+    i32 first = 0, count = map->keys.count;
+    while (count > 0) {
+        i32 step = count / 2;
+        if (!(key < map->keys.data[first+step])) {
+            first += step+1;
+            count -= step+1;
+        } else {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+template<typename K, typename V>
+i32 map_find_slot(SortedMap<K, V> *map, const K &key)
+{
+    i32 i = map_lower_bound(map, key);
+    if (i == map->keys.count || key < map->keys.data[i]) return -1;
+    return i;
+}
+
+// NOTE(jesper): the entries with keys in [first, last)
+template<typename K, typename V>
+typename SortedMap<K, V>::Range map_range(SortedMap<K, V> *map, const K &first, const K &last)
+{
+    i32 begin = map_lower_bound(map, first);
+    i32 end = MAX(begin, map_lower_bound(map, last));
+    return { map, begin, end };
+}
+
+template<typename K, typename V>
+i32 map_set_slot(SortedMap<K, V> *map, i32 index, const K &key, const V &value)
+{
+    if (!map->alloc.proc) map->alloc = mem_dynamic;
+    if (!map->keys.alloc.proc) map->keys.alloc = map->values.alloc = map->alloc;
+
+    array_insert(&map->keys, index, key);
+    array_insert(&map->values, index, value);
+    return index;
+}
+
+template<typename K, typename V>
+void map_set(SortedMap<K, V> *map, const K &key, const V &value)
+{
+    i32 i = map_lower_bound(map, key);
+    if (i < map->keys.count && !(key < map->keys.data[i])) map->values.data[i] = value;
+    else map_set_slot(map, i, key, value);
+}
+
+template<typename K, typename V>
+V* map_find(SortedMap<K, V> *map, const K &key)
+{
+    i32 i = map_find_slot(map, key);
+    if (i == -1) return nullptr;
+    return &map->values.data[i];
+}
+
+template<typename K, typename V>
+V* map_find_emplace(SortedMap<K, V> *map, const K &key, const V &emp_value = {})
+{
+    i32 i = map_lower_bound(map, key);
+    if (i == map->keys.count || key < map->keys.data[i]) map_set_slot(map, i, key, emp_value);
+    return &map->values.data[i];
+}
+
+template<typename K, typename V>
+void map_remove(SortedMap<K, V> *map, const K &key)
+{
+    i32 i = map_find_slot(map, key);
+    if (i == -1) return;
+
+    array_remove(&map->keys, i);
+    array_remove(&map->values, i);
+}
+
+// NOTE(jesper): sets every keys[i] to values[i]. If a key occurs more than
+// once, the last occurrence in the batch wins
+template<typename K, typename V>
+void map_set_batch(SortedMap<K, V> *map, Array<K> keys, Array<V> values)
+{
+    ASSERT(keys.count == values.count);
+    if (keys.count == 0) return;
+    if (!map->alloc.proc) map->alloc = mem_dynamic;
+
+    SArena scratch = tl_scratch_arena(map->alloc);
+    i32 *order = ALLOC_ARR(scratch, i32, keys.count);
+    for (i32 i = 0; i < keys.count; i++) order[i] = i;
+
+    quick_sort(Array<i32>{ order, keys.count }, [&keys](i32 a, i32 b) {
+        if (keys.data[a] < keys.data[b]) return true;
+        if (keys.data[b] < keys.data[a]) return false;
+        return a < b;
+    });
+
+    DynamicArray<K> dst_keys{};
+    DynamicArray<V> dst_values{};
+    dst_keys.alloc = map->alloc;
+    dst_values.alloc = map->alloc;
+    array_reserve(&dst_keys, map->keys.count + keys.count);
+    array_reserve(&dst_values, map->keys.count + keys.count);
+
+    i32 i = 0, j = 0;
+    while (i < map->keys.count || j < keys.count) {
+        if (j < keys.count) {
+            i32 src = order[j];
+
+            // NOTE(jesper): skip to the last of a run of equal keys in the batch
+            if (j+1 < keys.count && !(keys.data[src] < keys.data[order[j+1]])) {
+                j++;
+                continue;
+            }
+
+            if (i == map->keys.count || keys.data[src] < map->keys.data[i]) {
+                array_add(&dst_keys, keys.data[src]);
+                array_add(&dst_values, values.data[src]);
+                j++;
+                continue;
+            }
+
+            if (!(map->keys.data[i] < keys.data[src])) {
+                array_add(&dst_keys, keys.data[src]);
+                array_add(&dst_values, values.data[src]);
+                i++, j++;
+                continue;
+            }
+        }
+
+        array_add(&dst_keys, map->keys.data[i]);
+        array_add(&dst_values, map->values.data[i]);
+        i++;
+    }
+
+    if (map->keys.alloc.proc) array_destroy(&map->keys);
+    if (map->values.alloc.proc) array_destroy(&map->values);
+
+    map->keys = dst_keys;
+    map->values = dst_values;
+}
+
+template<typename V>
+V* map_find(SortedMap<String, V> *map, String key)
+{
+    i32 i = map_find_slot(map, key);
+    if (i == -1) return nullptr;
+    return &map->values.data[i];
+}
 #endif // MAP_H
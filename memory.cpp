@@ -5,22 +5,172 @@
 
 #define M_DEBUG_VIRTUAL_HEAP_ALLOC 0
 
+#define M_SLAB_LARGE_OFFSET 128
+
+// NOTE(jesper): linear allocators commit their reserved range in chunks of
+// M_ARENA_COMMIT_SIZE as they grow, and on a full reset decommit whatever lies
+// beyond M_ARENA_RETAIN_SIZE. Resets to a restore point keep their pages, those
+// happen at every scratch scope exit and the memory is about to be reused
+#define M_ARENA_COMMIT_SIZE (64*KiB)
+#define M_ARENA_RETAIN_SIZE (1*MiB)
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define M_ASAN 1
+#endif
+#endif
+
+#if !defined(M_ASAN) && defined(__SANITIZE_ADDRESS__)
+#define M_ASAN 1
+#endif
+
+#if M_ASAN
+extern "C" void __asan_poison_memory_region(void const volatile *addr, size_t size);
+extern "C" void __asan_unpoison_memory_region(void const volatile *addr, size_t size);
+
+#define M_ASAN_POISON(addr, size)   __asan_poison_memory_region(addr, size)
+#define M_ASAN_UNPOISON(addr, size) __asan_unpoison_memory_region(addr, size)
+#else
+#define M_ASAN_POISON(addr, size)   (void)0
+#define M_ASAN_UNPOISON(addr, size) (void)0
+#endif
+
+#if M_DEBUG_ARENAS
+struct ArenaDebugHeader {
+    ArenaDebugHeader *prev;
+    i64 size;
+};
+
+#define M_ARENA_HEADER_SIZE ((u8)sizeof(ArenaDebugHeader))
+#define M_ARENA_REDZONE_SIZE 16
+#else
+#define M_ARENA_HEADER_SIZE 0
+#define M_ARENA_REDZONE_SIZE 0
+#endif
+
 struct TlLinearAllocatorState {
     u8 *start;
     u8 *end;
     u8 *current;
+    u8 *committed;
 
     void *last;
+    u32 flags;
+    i32 numa_node;
+
+    i64 peak;
+    i64 alloc_count;
+
+#if M_DEBUG_ARENAS
+    ArenaDebugHeader *debug_last;
+#endif
 };
 
 struct LinearAllocatorState {
     u8 *start;
     u8 *end;
     u8 *current;
+    u8 *committed;
+
+    Mutex *mutex;
+    u32 flags;
+    i32 numa_node;
+
+    i64 peak;
+    i64 alloc_count;
+
+#if M_DEBUG_ARENAS
+    ArenaDebugHeader *debug_last;
+#endif
+};
+
+struct BlockAllocatorState {
+    struct Block {
+        Block *prev;
+        u8 *end;
+        i64 size;
+        i64 used;
+    };
+
+    Block *block;
+    Block *spare;
 
+    u8 *current;
     void *last;
 
+    i64 block_size;
+    Allocator backing;
+
+    // NOTE(jesper): totals of the blocks in the chain, so that M_INFO doesn't
+    // have to walk it. chain_used excludes the current block
+    i64 chain_size;
+    i64 chain_used;
+    i64 peak;
+    i64 alloc_count;
+
+    AllocatorNode *node;
+    BlockAllocatorState *pool_next;
+};
+
+struct SlabAllocatorState {
+    struct Slab {
+        Slab *next;
+        Slab *prev;
+
+        void *free;
+        u8 *bump;
+        u8 *end;
+
+        i32 size_class;
+        i32 used;
+        i64 run_size;
+    };
+
+    struct SizeClass {
+        Slab *partial;
+        i64 slabs;
+        i64 used;
+        i64 alloc_count;
+        Mutex *mutex;
+    };
+
+    u8 *mem;
+    u8 *end;
+    u8 *next_run;
+
+    SizeClass classes[M_SLAB_CLASSES];
+
+    Slab *free_runs[M_SLAB_RUN_BINS];
+    i64 large_count;
+    i64 large_used;
+    i64 large_alloc_count;
+
+    i64 committed;
+    i64 peak;
+
+    Mutex *mutex;
+    i32 page_size;
+};
+
+struct TrackingAllocatorState {
+    struct Header {
+        TrackedCallsite *site;
+        i64 size;
+        u32 offset;
+        u32 alignment;
+    };
+
+    Allocator backing;
     Mutex *mutex;
+
+    i64 live_count;
+    i64 live_bytes;
+    i64 peak_bytes;
+    i64 alloc_count;
+
+    TrackedCallsite untracked;
+    TrackedCallsite callsites[M_TRACK_CALLSITES];
+    i32 callsite_count;
 };
 
 #if defined(_WIN32)
@@ -34,10 +184,21 @@ struct LinearAllocatorState {
 Allocator mem_sys;
 Allocator mem_dynamic;
 
+thread_local MemCallsite mem_callsite;
+
 AllocatorNode mem_allocators;
-AllocatorNode *tail = &mem_allocators;
+i32 mem_allocators_lock;
+
+u32 mem_scratch_flags = 0;
+thread_local Allocator mem_scratch[M_SCRATCH_ARENAS];
 
-thread_local Allocator mem_scratch[2];
+// NOTE(jesper): released tl_arena arenas, bucketed by the log2 of their block
+// size. The buckets are short push/pop operations guarded by a spin lock
+struct ArenaPool {
+    BlockAllocatorState *arenas[M_ARENA_POOL_CLASSES];
+    i32 count[M_ARENA_POOL_CLASSES];
+    i32 lock;
+} arena_pool;
 
 i32 tl_scratch_idx(MArena arena) 
 {
@@ -48,6 +209,8 @@ i32 tl_scratch_idx(MArena arena)
 }
 
 void* align_ptr(void *ptr, u8 alignment, u8 header_size);
+void* tl_block_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
+void tl_block_allocator_destroy(BlockAllocatorState *state);
 
 template<typename T>
 T* get_header(const void *aligned_ptr) { return (T*)((size_t)aligned_ptr-sizeof(T)); }
@@ -61,40 +224,105 @@ void init_default_allocators()
     mem_dynamic = malloc_allocator();//vm_freelist_allocator(16*GiB);
 }
 
-MArena tl_scratch_arena(Allocator conflict)
+MArena tl_scratch_arena(const Allocator *conflicts, i32 count)
 {
-    Allocator *arena = conflict.state && conflict.state == mem_scratch[0].state ? &mem_scratch[1] : &mem_scratch[0];
+    Allocator *arena = nullptr;
+    for (Allocator &it : mem_scratch) {
+        bool conflicting = false;
+        for (i32 i = 0; i < count; i++) {
+            if (conflicts[i].state && conflicts[i].state == it.state) {
+                conflicting = true;
+                break;
+            }
+        }
+
+        if (!conflicting) {
+            arena = &it;
+            break;
+        }
+    }
+
+    PANIC_IF(!arena, "[mem] all %d scratch arenas are in conflict", M_SCRATCH_ARENAS);
 
     if (!arena->state) {
         LOG_INFO("creating scratch arena: %d", (i32)(arena - &mem_scratch[0]));
-        Allocator alloc = tl_linear_allocator(1*GiB);
+        Allocator alloc = tl_linear_allocator(1*GiB, mem_scratch_flags, "scratch");
         arena->state = alloc.state;
         arena->proc = alloc.proc;
-
-        AllocatorNode *node = ALLOC_T(mem_dynamic, AllocatorNode) {
-            .arena = arena,
-            .thread_owner = thread_id(),
-        };
-
-        AllocatorNode *next = nullptr;
-        do {
-            next = tail->next;
-            node->next = next;
-        } while (!atomic_compare_exchange(&tail->next, next, node));
     }
 
     auto state = (TlLinearAllocatorState*)arena->state;
     return { *arena, state->current };
 }
 
-MArena tl_arena(i32 initial_size)
+MArena tl_scratch_arena(std::initializer_list<Allocator> conflicts)
+{
+    return tl_scratch_arena(conflicts.begin(), (i32)conflicts.size());
+}
+
+MArena tl_scratch_arena(Allocator conflict)
+{
+    return tl_scratch_arena(&conflict, 1);
+}
+
+i32 arena_pool_class(i64 size)
+{
+    i32 pool_class = 0;
+    while (pool_class < M_ARENA_POOL_CLASSES-1 && (1LL << pool_class) < size) pool_class++;
+    return pool_class;
+}
+
+void arena_pool_lock()
+{
+    while (atomic_exchange(&arena_pool.lock, 1)) {}
+}
+
+void arena_pool_unlock()
+{
+    atomic_exchange(&arena_pool.lock, 0);
+}
+
+MArena tl_arena(i32 initial_size, const char *name)
 {
+    i32 pool_class = arena_pool_class(initial_size);
+
+    arena_pool_lock();
+    BlockAllocatorState *state = arena_pool.arenas[pool_class];
+    if (state) {
+        arena_pool.arenas[pool_class] = state->pool_next;
+        arena_pool.count[pool_class]--;
+    }
+    arena_pool_unlock();
+
+    if (state) {
+        state->pool_next = nullptr;
+        state->node->name = name;
+        state->node->thread_owner = thread_id();
+        return MArena{ Allocator{ state, tl_block_alloc } };
+    }
+
     LOG_INFO("[mem] creating arena: %d bytes", initial_size);
-    Allocator alloc = tl_linear_allocator(initial_size);
+    Allocator alloc = tl_block_allocator(1LL << pool_class, mem_dynamic, name);
     MArena arena{ alloc };
     return arena;
 }
 
+void arena_pool_release(BlockAllocatorState *state)
+{
+    i32 pool_class = arena_pool_class(state->block_size);
+
+    arena_pool_lock();
+    bool pooled = arena_pool.count[pool_class] < M_ARENA_POOL_MAX;
+    if (pooled) {
+        state->pool_next = arena_pool.arenas[pool_class];
+        arena_pool.arenas[pool_class] = state;
+        arena_pool.count[pool_class]++;
+    }
+    arena_pool_unlock();
+
+    if (!pooled) tl_block_allocator_destroy(state);
+}
+
 AllocatorInfo get_allocator_info(Allocator alloc)
 {
     AllocatorInfo info{};
@@ -102,6 +330,129 @@ AllocatorInfo get_allocator_info(Allocator alloc)
     return info;
 }
 
+void mem_allocators_lock_acquire()
+{
+    for (i32 spins = 0; atomic_exchange(&mem_allocators_lock, 1); ) spin_wait(&spins);
+}
+
+void mem_allocators_lock_release()
+{
+    atomic_exchange(&mem_allocators_lock, 0);
+}
+
+AllocatorNode* register_allocator(Allocator alloc, const char *name)
+{
+    mem_allocators_lock_acquire();
+    defer { mem_allocators_lock_release(); };
+
+    AllocatorNode *node = mem_allocators.next;
+    while (node && node->alloc.proc) node = node->next;
+
+    if (!node) {
+        // NOTE(jesper): nodes come straight from the system heap, the default
+        // allocators are registered before mem_dynamic exists
+        node = (AllocatorNode*)malloc(sizeof *node);
+        node->next = mem_allocators.next;
+        mem_allocators.next = node;
+    }
+
+    node->alloc = alloc;
+    node->name = name;
+    node->thread_owner = thread_id();
+    return node;
+}
+
+// NOTE(jesper): the node is kept in the list to be reused by the next
+// registration. Waits for any snapshot still querying the allocator, the
+// caller is about to destroy it
+void unregister_allocator(AllocatorNode *node)
+{
+    mem_allocators_lock_acquire();
+    node->alloc = {};
+    node->name = nullptr;
+    mem_allocators_lock_release();
+
+    for (i32 spins = 0; atomic_load(&node->readers) > 0; ) spin_wait(&spins);
+}
+
+// NOTE(jesper): the allocators are queried outside of the registry lock, which
+// would otherwise block every allocator creation and destruction on the
+// slowest M_INFO. Each queried node holds a reader count that keeps
+// unregister_allocator from returning until we're done with it
+i32 get_allocator_snapshots(AllocatorSnapshot *dst, i32 max_count)
+{
+    SArena scratch = tl_scratch_arena();
+    auto *nodes = ALLOC_ARR(*scratch, AllocatorNode*, max_count);
+    auto *allocs = ALLOC_ARR(*scratch, Allocator, max_count);
+
+    i32 count = 0;
+    mem_allocators_lock_acquire();
+    for (AllocatorNode *node = mem_allocators.next; node && count < max_count; node = node->next) {
+        if (!node->alloc.proc) continue;
+
+        atomic_fetch_add(&node->readers, 1);
+        nodes[count] = node;
+        allocs[count] = node->alloc;
+        dst[count++] = { .name = node->name, .thread_owner = node->thread_owner };
+    }
+    mem_allocators_lock_release();
+
+    for (i32 i = 0; i < count; i++) {
+        dst[i].info = get_allocator_info(allocs[i]);
+        atomic_fetch_sub(&nodes[i]->readers, 1);
+    }
+
+    return count;
+}
+
+void log_allocator_report()
+{
+    SArena scratch = tl_scratch_arena();
+
+    // NOTE(jesper): allocators may be registered while we're taking the
+    // snapshots, so grow the buffer until it isn't filled
+    AllocatorSnapshot *snapshots;
+    i32 count, capacity = 64;
+    while (true) {
+        snapshots = ALLOC_ARR(*scratch, AllocatorSnapshot, capacity);
+        count = get_allocator_snapshots(snapshots, capacity);
+        if (count < capacity) break;
+        capacity *= 2;
+    }
+
+    i64 used = 0, committed = 0;
+    for (i32 i = 0; i < count; i++) {
+        used += snapshots[i].info.used;
+        committed += snapshots[i].info.committed;
+    }
+
+    LOG_INFO("[mem] %d allocators: %lld bytes used, %lld bytes committed", count, used, committed);
+
+    // NOTE(jesper): an allocator's pages all prefer the node its range was
+    // bound to, so the per-node usage is the sum over the allocators bound to it
+    i64 node_used[64]{}, node_committed[64]{};
+    for (i32 i = 0; i < count; i++) {
+        i32 node = snapshots[i].info.numa_node;
+        if (node < 0 || node >= ARRAY_COUNT(node_used)) continue;
+
+        node_used[node] += snapshots[i].info.used;
+        node_committed[node] += snapshots[i].info.committed;
+    }
+
+    for (i32 node = 0; node < ARRAY_COUNT(node_used); node++) {
+        if (node_committed[node] == 0) continue;
+        LOG_INFO("[mem]   numa node %d: %lld bytes used, %lld bytes committed", node, node_used[node], node_committed[node]);
+    }
+
+    for (i32 i = 0; i < count; i++) {
+        AllocatorSnapshot *it = &snapshots[i];
+        LOG_INFO("[mem]   %s (thread %lld): %lld bytes used, peak %lld bytes, %lld bytes committed of %lld, %lld allocations, %.0f%% fragmented",
+                 it->name, it->thread_owner,
+                 it->info.used, it->info.peak, it->info.committed, it->info.size,
+                 it->info.alloc_count, it->info.fragmentation*100.0f);
+    }
+}
+
 void restore_arena(MArena *arena)
 {
     arena->proc(arena->state, M_RESET, arena->restore_point, 0, 0, 0);
@@ -111,10 +462,18 @@ void release_arena(MArena *arena)
 {
     restore_arena(arena);
     i32 idx = tl_scratch_idx(*arena);
-    if (idx == -1) {
-        // TODO(jesper): push this into a free-list of arenas, or some such
-        LOG_ERROR("[mem] leaking arena");
+    if (idx != -1) return;
+
+    if (arena->proc == tl_block_alloc) {
+        // NOTE(jesper): reset all the way to the start, the arena's first block
+        // stays around for the next tl_arena of the same size class
+        RESET_ALLOC(*arena);
+        arena_pool_release((BlockAllocatorState*)arena->state);
+        arena->state = nullptr;
+        return;
     }
+
+    LOG_ERROR("[mem] leaking arena");
 }
 
 void* align_ptr(void *ptr, u8 alignment, u8 header_size)
@@ -124,17 +483,116 @@ void* align_ptr(void *ptr, u8 alignment, u8 header_size)
     return (void*)((addr + mask) & ~mask);
 }
 
+i64 arena_commit_size(u32 flags)
+{
+    // NOTE(jesper): commit transparent huge page ranges in huge page units, as
+    // committing a part of one splits it into small pages
+    return flags & M_HUGE_PAGES ? M_HUGE_PAGE_SIZE : M_ARENA_COMMIT_SIZE;
+}
+
+void arena_commit(u8 **committed, u8 *end, u8 *required, u32 flags)
+{
+    i64 page_size = get_page_size();
+    i64 commit_size = arena_commit_size(flags);
+
+    size_t limit = ((size_t)end + page_size-1) & ~(size_t)(page_size-1);
+    size_t commit_end = ((size_t)required + commit_size-1) & ~(size_t)(commit_size-1);
+    commit_end = MIN(commit_end, limit);
+
+    void *ptr = virtual_commit(*committed, (u8*)commit_end - *committed);
+    PANIC_IF(!ptr, "failed to commit arena memory: %lld bytes", (i64)((u8*)commit_end - *committed));
+    *committed = (u8*)commit_end;
+}
+
+void arena_decommit(u8 **committed, u8 *current, u32 flags)
+{
+    // NOTE(jesper): explicit huge pages are committed for the lifetime of the mapping
+    if (flags & M_HUGE_PAGES_EXPLICIT) return;
+
+    i64 commit_size = arena_commit_size(flags);
+    size_t retain = ((size_t)current + M_ARENA_RETAIN_SIZE + commit_size-1) & ~(size_t)(commit_size-1);
+    if ((u8*)retain >= *committed) return;
+
+    virtual_decommit((u8*)retain, *committed - (u8*)retain);
+    *committed = (u8*)retain;
+}
+
+#if M_DEBUG_ARENAS
+void arena_debug_mark(ArenaDebugHeader *header, i64 size)
+{
+    u8 *ptr = (u8*)(header+1);
+    M_ASAN_UNPOISON(header, sizeof *header + size + M_ARENA_REDZONE_SIZE);
+
+    header->size = size;
+    memset(ptr+size, M_ARENA_REDZONE_BYTE, M_ARENA_REDZONE_SIZE);
+    M_ASAN_POISON(ptr+size, M_ARENA_REDZONE_SIZE);
+}
+
+void arena_debug_check(ArenaDebugHeader *header)
+{
+    u8 *redzone = (u8*)(header+1) + header->size;
+    M_ASAN_UNPOISON(redzone, M_ARENA_REDZONE_SIZE);
+
+    bool overrun = false;
+    for (i32 i = 0; i < M_ARENA_REDZONE_SIZE; i++) overrun |= redzone[i] != M_ARENA_REDZONE_BYTE;
+    PANIC_IF(overrun, "arena overrun detected past allocation [%p] of %lld bytes", header+1, header->size);
+}
+
+// NOTE(jesper): checks the redzones of the allocations past the restore point
+// and unlinks them, then poisons the released memory. The headers of a
+// thread-local arena are in address order, so the walk can stop at the first
+// one below the restore point; a shared arena's headers can be pushed out of
+// order by concurrent allocations, so the whole chain is walked
+ArenaDebugHeader* arena_debug_reset(ArenaDebugHeader *last, u8 *restore, u8 *current, bool ordered)
+{
+    ArenaDebugHeader *head = nullptr;
+    ArenaDebugHeader **tail = &head;
+
+    ArenaDebugHeader *it = last;
+    while (it) {
+        ArenaDebugHeader *prev = it->prev;
+        if ((u8*)(it+1) < restore) {
+            *tail = it;
+            if (ordered) break;
+            tail = &it->prev;
+        } else {
+            arena_debug_check(it);
+        }
+        it = prev;
+    }
+    if (!it) *tail = nullptr;
+
+    if (current > restore) {
+        M_ASAN_UNPOISON(restore, current - restore);
+        memset(restore, M_ARENA_POISON_BYTE, current - restore);
+        M_ASAN_POISON(restore, current - restore);
+    }
+
+    return head;
+}
+#endif
+
 void* tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
 {
     auto state = (TlLinearAllocatorState*)v_state;
 
     switch (cmd) {
     case M_ALLOC: {
-        u8 *ptr = (u8*)align_ptr(state->current, alignment, 0);
-        PANIC_IF(ptr+size > state->end, "allocator does not have enough memory for allocation: %lld", size);
+        u8 *ptr = (u8*)align_ptr(state->current, alignment, M_ARENA_HEADER_SIZE);
+        u8 *current = ptr + size + M_ARENA_REDZONE_SIZE;
+        PANIC_IF(current > state->end, "allocator does not have enough memory for allocation: %lld", size);
+        if (current > state->committed) arena_commit(&state->committed, state->end, current, state->flags);
 
-        state->current = ptr+size;
+        state->current = current;
         state->last = ptr;
+        state->alloc_count++;
+
+#if M_DEBUG_ARENAS
+        auto header = get_header<ArenaDebugHeader>(ptr);
+        arena_debug_mark(header, size);
+        header->prev = state->debug_last;
+        state->debug_last = header;
+#endif
         return ptr;
         }
     case M_FREE:
@@ -143,11 +601,23 @@ void* tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_si
         auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
         info->size = state->end - state->start;
         info->used = state->current - state->start;
+        info->peak = MAX(state->peak, info->used);
+        info->committed = state->committed - (u8*)state;
+        info->alloc_count = state->alloc_count;
+        info->flags = state->flags;
+        info->numa_node = state->numa_node;
         return nullptr;
         }
     case M_REALLOC: {
         if (old_ptr && state->last == old_ptr) {
-            state->current += size-old_size;
+            u8 *current = (u8*)old_ptr + size + M_ARENA_REDZONE_SIZE;
+            PANIC_IF(current > state->end, "allocator does not have enough memory for allocation: %lld", size);
+            if (current > state->committed) arena_commit(&state->committed, state->end, current, state->flags);
+
+            state->current = current;
+#if M_DEBUG_ARENAS
+            arena_debug_mark(get_header<ArenaDebugHeader>(old_ptr), size);
+#endif
             return (void*)old_ptr;
         }
 
@@ -157,7 +627,14 @@ void* tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_si
         }
     case M_EXTEND: {
         if (old_ptr && state->last == old_ptr) {
-            state->current += size-old_size;
+            u8 *current = (u8*)old_ptr + size + M_ARENA_REDZONE_SIZE;
+            PANIC_IF(current > state->end, "allocator does not have enough memory for allocation: %lld", size);
+            if (current > state->committed) arena_commit(&state->committed, state->end, current, state->flags);
+
+            state->current = current;
+#if M_DEBUG_ARENAS
+            arena_debug_mark(get_header<ArenaDebugHeader>(old_ptr), size);
+#endif
             return (void*)old_ptr;
         }
 
@@ -165,8 +642,17 @@ void* tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_si
         return ptr;
         }
     case M_RESET:
+#if M_DEBUG_ARENAS
+        state->debug_last = arena_debug_reset(
+            state->debug_last,
+            old_ptr ? (u8*)old_ptr : state->start,
+            state->current,
+            true);
+#endif
+        state->peak = MAX(state->peak, state->current - state->start);
         state->last = nullptr;
         state->current = old_ptr ? (u8*)old_ptr : state->start;
+        if (!old_ptr) arena_decommit(&state->committed, state->current, state->flags);
         return nullptr;
     }
 
@@ -174,135 +660,341 @@ void* tl_linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_si
     return nullptr;
 }
 
+// NOTE(jesper): commits pages for a shared linear allocator. Only taken on the
+// slow path when an allocation crosses the committed high-water mark
+void linear_commit(LinearAllocatorState *state, u8 *required)
+{
+    GUARD_MUTEX(state->mutex) {
+        if (required > state->committed) arena_commit(&state->committed, state->end, required, state->flags);
+    }
+}
+
+// NOTE(jesper): thread-safe bump allocation. Allocations race on a CAS of
+// state->current, and the mutex is only taken to commit more pages.
+// The in-place extend of the last allocation checks current against the end of
+// the allocation instead of keeping a state->last pointer, which can't be
+// updated in the same CAS as current. This only identifies the last allocation
+// if every allocation moves current forward, so zero-sized allocations take a
+// byte
+u8* linear_bump(LinearAllocatorState *state, i64 size, u8 alignment)
+{
+    u8 *current, *ptr;
+    do {
+        current = state->current;
+        ptr = (u8*)align_ptr(current, alignment, M_ARENA_HEADER_SIZE);
+        u8 *end = ptr + MAX(size, 1) + M_ARENA_REDZONE_SIZE;
+        PANIC_IF(end > state->end, "allocator does not have enough memory for allocation: %lld", size);
+        if (end > state->committed) linear_commit(state, end);
+    } while (!atomic_compare_exchange(&state->current, current, ptr + MAX(size, 1) + M_ARENA_REDZONE_SIZE));
+    atomic_fetch_add(&state->alloc_count, 1);
+
+#if M_DEBUG_ARENAS
+    auto header = get_header<ArenaDebugHeader>(ptr);
+    arena_debug_mark(header, size);
+    header->prev = atomic_exchange(&state->debug_last, header);
+#endif
+    return ptr;
+}
+
+bool linear_extend_inplace(LinearAllocatorState *state, const void *old_ptr, i64 old_size, i64 size)
+{
+    if (!old_ptr) return false;
+
+    u8 *old_end = (u8*)old_ptr + MAX(old_size, 1) + M_ARENA_REDZONE_SIZE;
+    u8 *new_end = (u8*)old_ptr + MAX(size, 1) + M_ARENA_REDZONE_SIZE;
+    if (state->current != old_end) return false;
+
+    PANIC_IF(new_end > state->end, "allocator does not have enough memory for allocation: %lld", size);
+    if (new_end > state->committed) linear_commit(state, new_end);
+    if (!atomic_compare_exchange(&state->current, old_end, new_end)) return false;
+
+#if M_DEBUG_ARENAS
+    arena_debug_mark(get_header<ArenaDebugHeader>(old_ptr), size);
+#endif
+    return true;
+}
+
 void* linear_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
 {
     auto state = (LinearAllocatorState*)v_state;
 
     switch (cmd) {
-    case M_ALLOC: {
-        u8 *ptr;
-        GUARD_MUTEX(state->mutex) {
-            ptr = (u8*)align_ptr(state->current, alignment, 0);
-            PANIC_IF(ptr+size > state->end, "allocator does not have enough memory for allocation: %lld", size);
-
-            state->current = ptr+size;
-            state->last = ptr;
-        }
-
-        return ptr;
-        }
+    case M_ALLOC:
+        return linear_bump(state, size, alignment);
     case M_FREE:
         return nullptr;
     case M_INFO: {
         auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
-        GUARD_MUTEX(state->mutex) {
-            info->size = state->end - state->start;
-            info->used = state->current - state->start;
-        }
+        info->size = state->end - state->start;
+        info->used = state->current - state->start;
+        info->peak = MAX(state->peak, info->used);
+        info->committed = state->committed - (u8*)state;
+        info->alloc_count = state->alloc_count;
+        info->flags = state->flags;
+        info->numa_node = state->numa_node;
         return nullptr;
         }
     case M_REALLOC: {
-        u8 *ptr;
-        GUARD_MUTEX(state->mutex) {
-            if (old_ptr && state->last == old_ptr) {
-                state->current += size-old_size;
+        if (linear_extend_inplace(state, old_ptr, old_size, size)) return (void*)old_ptr;
 
-                // NOTE(jesper): manual unlocking before return because the GUARD_MUTEX macro does not automatically unlock the mutex if we break out of the scope manually
-                unlock_mutex(state->mutex);
-                return (void*)old_ptr;
-            }
+        u8 *ptr = linear_bump(state, size, alignment);
+        if (size > 0 && old_size > 0) memcpy(ptr, old_ptr, MIN(old_size, size));
+        return ptr;
+        }
+    case M_EXTEND:
+        if (linear_extend_inplace(state, old_ptr, old_size, size)) return (void*)old_ptr;
+        return linear_bump(state, size, alignment);
+    case M_RESET:
+        // NOTE(jesper): resetting must not race any allocation on the arena, the
+        // caller is expected to reset it once all the threads allocating from it
+        // are done, e.g. at the end of a frame
+#if M_DEBUG_ARENAS
+        state->debug_last = arena_debug_reset(
+            state->debug_last,
+            old_ptr ? (u8*)old_ptr : state->start,
+            state->current,
+            false);
+#endif
+        state->peak = MAX(state->peak, state->current - state->start);
+        atomic_exchange(&state->current, old_ptr ? (u8*)old_ptr : state->start);
+        if (!old_ptr) arena_decommit(&state->committed, state->current, state->flags);
+        return nullptr;
+    }
 
-            ptr = (u8*)align_ptr(state->current, alignment, 0);
-            PANIC_IF(ptr+size > state->end, "allocator does not have enough memory for allocation: %lld", size);
-            if (size > 0 && old_size > 0) memcpy(ptr, old_ptr, old_size);
+    PANIC("unhandled allocator procedure: %d", cmd);
+    return nullptr;
+}
 
-            state->current = ptr+size;
-            state->last = ptr;
-        }
+struct MallocHeader {
+    i64 size;
+    u8 offset;
+    u8 alignment;
+    u8 large;
+};
 
-        return ptr;
-        }
-    case M_EXTEND: {
-        u8 *ptr;
-        GUARD_MUTEX(state->mutex) {
-            if (old_ptr && state->last == old_ptr) {
-                state->current += size-old_size;
+// NOTE(jesper): the heap's usage is counted per thread, so that allocating
+// doesn't contend on a shared counter, and summed when queried. A thread's
+// counters are handed to the next thread to start when it exits, they may hold
+// bytes freed by other threads. The peak is the highest sum seen by M_INFO
+struct MallocThreadCounters {
+    i64 used;
+    i64 alloc_count;
+    i32 in_use;
+    MallocThreadCounters *next;
+};
 
-                // NOTE(jesper): manual unlocking before return because the GUARD_MUTEX macro does not automatically unlock the mutex if we break out of the scope manually
-                unlock_mutex(state->mutex);
-                return (void*)old_ptr;
-            }
+struct MallocAllocatorState {
+    MallocThreadCounters *counters;
+    MallocThreadCounters orphan;
+    i64 peak;
+} malloc_state;
+
+struct TlMallocCounters {
+    MallocThreadCounters *counters;
+    bool exited;
+
+    ~TlMallocCounters()
+    {
+        exited = true;
+        if (counters) atomic_exchange(&counters->in_use, 0);
+        counters = nullptr;
+    }
+};
 
-            ptr = (u8*)align_ptr(state->current, alignment, 0);
-            PANIC_IF(ptr+size > state->end, "allocator does not have enough memory for allocation: %lld", size);
+thread_local TlMallocCounters tl_malloc_counters;
 
-            state->current = ptr+size;
-            state->last = ptr;
-        }
+MallocThreadCounters* malloc_claim_counters()
+{
+    for (MallocThreadCounters *it = malloc_state.counters; it; it = it->next) {
+        if (atomic_compare_exchange(&it->in_use, 0, 1)) return it;
+    }
 
-        return ptr;
-        }
-    case M_RESET:
-        GUARD_MUTEX(state->mutex) {
-            state->last = nullptr;
-            state->current = old_ptr ? (u8*)old_ptr : state->start;
-        }
-        return nullptr;
+    auto *counters = (MallocThreadCounters*)malloc(sizeof(MallocThreadCounters));
+    *counters = {};
+    counters->in_use = 1;
+
+    MallocThreadCounters *head;
+    do {
+        head = malloc_state.counters;
+        counters->next = head;
+    } while (!atomic_compare_exchange(&malloc_state.counters, head, counters));
+    return counters;
+}
+
+void malloc_track(i64 delta, i64 alloc_count)
+{
+    // NOTE(jesper): allocations made by other thread_local destructors after
+    // ours has run go to the shared counters
+    if (tl_malloc_counters.exited) {
+        atomic_fetch_add(&malloc_state.orphan.used, delta);
+        if (alloc_count) atomic_fetch_add(&malloc_state.orphan.alloc_count, alloc_count);
+        return;
     }
 
-    PANIC("unhandled allocator procedure: %d", cmd);
-    return nullptr;
+    if (!tl_malloc_counters.counters) tl_malloc_counters.counters = malloc_claim_counters();
+
+    MallocThreadCounters *counters = tl_malloc_counters.counters;
+    counters->used += delta;
+    counters->alloc_count += alloc_count;
 }
 
-void* malloc_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+// NOTE(jesper): large blocks are mapped with the mapping's size at its start,
+// followed by the aligned allocation. The mapping is page aligned, so the
+// alignment offset is the same after it's been remapped elsewhere
+i64* malloc_large_mapping(const void *ptr)
 {
-    struct Header {
-        u8 offset;
-        u8 alignment;
-    };
+    MallocHeader *header = get_header<MallocHeader>(ptr);
+    return (i64*)((size_t)ptr - header->offset);
+}
+
+i64 malloc_large_size(i64 size, u8 alignment)
+{
+    i64 page_size = get_page_size();
+    i64 total = (i64)sizeof(i64) + size + alignment + sizeof(MallocHeader) - 1;
+    return (total + page_size-1) & ~(page_size-1);
+}
+
+void* malloc_large_alloc(i64 size, u8 alignment)
+{
+    i64 mapped_size = malloc_large_size(size, alignment);
+    i64 *mapping = (i64*)virtual_map(mapped_size);
+    if (!mapping) return nullptr;
 
+    *mapping = mapped_size;
+    void *aligned_ptr = align_ptr(mapping+1, alignment, sizeof(MallocHeader));
+
+    auto header = get_header<MallocHeader>(aligned_ptr);
+    header->size = size;
+    header->offset = (u8)((size_t)aligned_ptr - (size_t)mapping);
+    header->alignment = alignment;
+    header->large = true;
+
+    malloc_track(size, 1);
+    return aligned_ptr;
+}
+
+void* malloc_large_realloc(const void *ptr, i64 size, bool may_move)
+{
+    i64 *mapping = malloc_large_mapping(ptr);
+    MallocHeader *header = get_header<MallocHeader>(ptr);
+    u8 offset = header->offset;
+
+    i64 old_size = header->size;
+
+    i64 mapped_size = malloc_large_size(size, header->alignment);
+    if (mapped_size != *mapping) {
+        mapping = (i64*)virtual_remap(mapping, *mapping, mapped_size, may_move);
+        if (!mapping) return nullptr;
+        *mapping = mapped_size;
+    }
+
+    void *aligned_ptr = (u8*)mapping + offset;
+    get_header<MallocHeader>(aligned_ptr)->size = size;
+
+    malloc_track(size - old_size, 0);
+    return aligned_ptr;
+}
+
+void* malloc_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+{
     switch (cmd) {
     case M_ALLOC: {
-        u8 header_size = sizeof(Header);
+        if (size >= M_MALLOC_LARGE_SIZE) return malloc_large_alloc(size, alignment);
+
+        u8 header_size = sizeof(MallocHeader);
         void *ptr = malloc(size+alignment+header_size-1);
         void *aligned_ptr = align_ptr(ptr, alignment, header_size);
 
-        auto header = get_header<Header>(aligned_ptr); header->offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
+        auto header = get_header<MallocHeader>(aligned_ptr);
+        header->size = size;
+        header->offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
         header->alignment = alignment;
+        header->large = false;
+
+        malloc_track(size, 1);
         return aligned_ptr;
         }
     case M_FREE:
         if (old_ptr) {
-            Header *header = get_header<Header>(old_ptr);
+            MallocHeader *header = get_header<MallocHeader>(old_ptr);
+            malloc_track(-header->size, 0);
+
             void *unaligned_ptr = (void*)((size_t)old_ptr - header->offset);
-            free(unaligned_ptr);
+            if (header->large) virtual_unmap(unaligned_ptr, *(i64*)unaligned_ptr);
+            else free(unaligned_ptr);
         }
         return nullptr;
     case M_INFO: {
+        // NOTE(jesper): the heap has no fixed capacity, and its committed memory
+        // and fragmentation aren't known outside of malloc
         auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
+
+        i64 used = malloc_state.orphan.used;
+        i64 alloc_count = malloc_state.orphan.alloc_count;
+        for (MallocThreadCounters *it = malloc_state.counters; it; it = it->next) {
+            used += it->used;
+            alloc_count += it->alloc_count;
+        }
+
+        i64 peak = malloc_state.peak;
+        while (used > peak && !atomic_compare_exchange(&malloc_state.peak, peak, used)) peak = malloc_state.peak;
+
         info->size = 0;
-        info->used = 0;
+        info->used = used;
+        info->peak = MAX(peak, used);
+        info->committed = used;
+        info->alloc_count = alloc_count;
         return nullptr;
         }
     case M_REALLOC: {
         void *old_unaligned_ptr = nullptr;
+        u8 old_offset = 0;
+        i64 old_tracked = 0;
         if (old_ptr) {
-            Header *header = get_header<Header>(old_ptr);
+            MallocHeader *header = get_header<MallocHeader>(old_ptr);
             ASSERT(header->alignment == alignment);
+            if (header->large) return malloc_large_realloc(old_ptr, size, true);
+
+            old_offset = header->offset;
+            old_tracked = header->size;
             old_unaligned_ptr = (void*)((size_t)old_ptr - header->offset);
         }
 
-        u8 header_size = sizeof(Header);
+        if (size >= M_MALLOC_LARGE_SIZE) {
+            void *ptr = malloc_large_alloc(size, alignment);
+            if (old_ptr) {
+                memcpy(ptr, old_ptr, MIN(old_size, size));
+                malloc_track(-old_tracked, 0);
+                free(old_unaligned_ptr);
+            }
+            return ptr;
+        }
+
+        u8 header_size = sizeof(MallocHeader);
         void *ptr = realloc(old_unaligned_ptr, size+alignment+header_size-1);
         void *aligned_ptr = align_ptr(ptr, alignment, header_size);
 
-        auto header = get_header<Header>(aligned_ptr);
+        // NOTE(jesper): realloc only preserves the data relative to the
+        // unaligned pointer, move it if the alignment offset changed
+        u8 offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
+        if (old_ptr && offset != old_offset) {
+            memmove(aligned_ptr, (u8*)ptr + old_offset, MIN(old_size, size));
+        }
+
+        auto header = get_header<MallocHeader>(aligned_ptr);
+        header->size = size;
         header->offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
         header->alignment = alignment;
+        header->large = false;
 
+        malloc_track(size - old_tracked, old_ptr ? 0 : 1);
         return aligned_ptr;
         }
     case M_EXTEND:
+        if (old_ptr && get_header<MallocHeader>(old_ptr)->large) {
+            void *ptr = malloc_large_realloc(old_ptr, size, false);
+            if (ptr) return ptr;
+        }
         return malloc_alloc(v_state, M_ALLOC, old_ptr, old_size, size, alignment);
     case M_RESET:
         LOG_ERROR("reset called on malloc allocator, unsupported");
@@ -313,165 +1005,387 @@ void* malloc_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size,
     return nullptr;
 }
 
-Allocator tl_linear_allocator(i64 size)
+// NOTE(jesper): reserves the arena's address range with a trailing guard page
+// that is never committed, so that writes past the end fault instead of
+// silently corrupting whatever follows. Explicit huge page mappings are
+// committed up-front and can't have a small guard page
+u8* arena_reserve(i64 size, i64 header_size, u32 flags, u8 **committed, u32 *obtained_flags, i32 *numa_node)
+{
+    i64 page_size = get_page_size();
+    i64 reserve_size = ((MAX(size, header_size) + page_size-1) & ~(page_size-1)) + page_size;
+
+    u8 *mem = (u8*)virtual_reserve(reserve_size, flags, obtained_flags, numa_node);
+    PANIC_IF(!mem, "failed to reserve arena memory: %lld bytes", reserve_size);
+
+    *committed = mem;
+    if (*obtained_flags & M_HUGE_PAGES_EXPLICIT) {
+        *committed = mem + reserve_size - page_size;
+    } else {
+        arena_commit(committed, mem+size, mem+header_size, *obtained_flags);
+    }
+
+    return mem;
+}
+
+Allocator tl_linear_allocator(i64 size, u32 flags, const char *name)
 {
-    u8 *mem = (u8*)malloc(size);
+    u8 *committed;
+    u32 obtained_flags;
+    i32 numa_node;
+    u8 *mem = arena_reserve(size, sizeof(TlLinearAllocatorState), flags, &committed, &obtained_flags, &numa_node);
 
     TlLinearAllocatorState *state = (TlLinearAllocatorState*)mem;
     *state = {
         .start = mem + sizeof *state,
         .end = mem+size,
         .current = mem + sizeof *state,
+        .committed = committed,
         .last = nullptr,
+        .flags = obtained_flags,
+        .numa_node = numa_node,
     };
 
-    return Allocator{ state, tl_linear_alloc };
+    Allocator alloc{ state, tl_linear_alloc };
+    register_allocator(alloc, name);
+    return alloc;
 }
 
-Allocator linear_allocator(i64 size)
+Allocator linear_allocator(i64 size, u32 flags, const char *name)
 {
-    u8 *mem = (u8*)malloc(size);
+    u8 *committed;
+    u32 obtained_flags;
+    i32 numa_node;
+    u8 *mem = arena_reserve(size, sizeof(LinearAllocatorState), flags, &committed, &obtained_flags, &numa_node);
 
     LinearAllocatorState *state = new (mem) LinearAllocatorState {
         .start = mem + sizeof *state,
         .end = mem+size,
         .current = mem + sizeof *state,
-        .last = nullptr,
+        .committed = committed,
         .mutex = create_mutex(),
+        .flags = obtained_flags,
+        .numa_node = numa_node,
     };
 
-    return Allocator{ state, linear_alloc };
+    Allocator alloc{ state, linear_alloc };
+    register_allocator(alloc, name);
+    return alloc;
 }
 
-Allocator malloc_allocator()
+u8* block_data(BlockAllocatorState::Block *block)
 {
-    return Allocator{ nullptr, malloc_alloc };
+    return (u8*)(block+1);
 }
 
+void block_recycle(BlockAllocatorState *state, BlockAllocatorState::Block *block)
+{
+    if (state->spare && state->spare->size >= block->size) {
+        FREE(state->backing, block);
+        return;
+    }
 
-void* vm_freelist_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+    if (state->spare) FREE(state->backing, state->spare);
+    state->spare = block;
+}
+
+BlockAllocatorState::Block* block_push(BlockAllocatorState *state, i64 size, u8 alignment)
 {
-    struct Header {
-        u64 total_size;
-        u8 offset;
-        u8 alignment;
-    };
+    using Block = BlockAllocatorState::Block;
 
-    using Block = VMFreeListState::Block;
+    i64 required = size + alignment-1;
+
+    Block *block;
+    if (state->spare && state->spare->size >= required) {
+        block = state->spare;
+        state->spare = nullptr;
+    } else {
+        i64 block_size = MAX(state->block_size, required);
+        block = (Block*)ALLOC(state->backing, sizeof(Block) + block_size);
+        PANIC_IF(!block, "failed to allocate arena block: %lld bytes", block_size);
+
+        block->size = block_size;
+        block->end = block_data(block) + block_size;
+    }
+
+    if (state->block) {
+        state->block->used = state->current - block_data(state->block);
+        state->chain_used += state->block->used;
+    }
+    state->chain_size += block->size;
+
+    block->prev = state->block;
+    block->used = 0;
+
+    state->block = block;
+    state->current = block_data(block);
+    return block;
+}
+
+void* tl_block_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+{
+    using Block = BlockAllocatorState::Block;
+    auto state = (BlockAllocatorState*)v_state;
 
-    auto state = (VMFreeListState*)v_state;
     switch (cmd) {
     case M_ALLOC: {
-            lock_mutex(state->mutex);
-            defer { unlock_mutex(state->mutex); };
+        u8 *ptr = state->block ? (u8*)align_ptr(state->current, alignment, 0) : nullptr;
+        if (!ptr || ptr+size > state->block->end) {
+            block_push(state, size, alignment);
+            ptr = (u8*)align_ptr(state->current, alignment, 0);
+        }
 
-            u8 header_size = sizeof(Header);
-            i64 minimum_size = sizeof(Block);
-            i64 required_size = size+alignment+header_size-1;
+        state->current = ptr+size;
+        state->last = ptr;
+        state->alloc_count++;
+        return ptr;
+        }
+    case M_FREE:
+        return nullptr;
+    case M_INFO: {
+        auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
+        Block *block = state->block;
 
-            auto block = state->free_block;
-            while (block && block->size < required_size) block = block->next;
-            if (!block) {
-                i64 commit_size = ROUND_TO(required_size, state->page_size);
-                if (state->committed + commit_size > state->reserved) {
-                    LOG_ERROR("virtual size exceeded");
-                    return nullptr;
-                }
+        info->size = state->chain_size;
+        info->used = state->chain_used + (block ? state->current - block_data(block) : 0);
+        info->peak = MAX(state->peak, info->used);
+        info->committed = state->chain_size;
+        info->alloc_count = state->alloc_count;
+        return nullptr;
+        }
+    case M_REALLOC: {
+        if (old_ptr && state->last == old_ptr && (u8*)old_ptr + size <= state->block->end) {
+            state->current = (u8*)old_ptr + size;
+            return (void*)old_ptr;
+        }
+
+        void *ptr = tl_block_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        if (size > 0 && old_size > 0) memcpy(ptr, old_ptr, MIN(old_size, size));
+        return ptr;
+        }
+    case M_EXTEND: {
+        if (old_ptr && state->last == old_ptr && (u8*)old_ptr + size <= state->block->end) {
+            state->current = (u8*)old_ptr + size;
+            return (void*)old_ptr;
+        }
+
+        return tl_block_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        }
+    case M_RESET: {
+        state->last = nullptr;
+        if (!state->block) return nullptr;
+
+        // NOTE(jesper): a restore point may lie in any block of the chain, pop
+        // the blocks allocated after it. Resetting to start keeps the oldest
+        // block in the chain
+        u8 *restore = (u8*)old_ptr;
+        Block *block = state->block;
+        state->peak = MAX(state->peak, state->chain_used + (state->current - block_data(block)));
+
+        while (block->prev && (!restore || restore < block_data(block) || restore > block->end)) {
+            Block *prev = block->prev;
+            state->chain_size -= block->size;
+            state->chain_used -= prev->used;
+
+            block_recycle(state, block);
+            block = prev;
+        }
+
+        state->block = block;
+        state->current = restore ? restore : block_data(block);
+        return nullptr;
+        }
+    }
+
+    PANIC("unhandled allocator procedure: %d", cmd);
+    return nullptr;
+}
+
+void tl_block_allocator_destroy(BlockAllocatorState *state)
+{
+    using Block = BlockAllocatorState::Block;
+    if (state->node) unregister_allocator(state->node);
+
+    for (Block *block = state->block; block; ) {
+        Block *prev = block->prev;
+        FREE(state->backing, block);
+        block = prev;
+    }
+
+    if (state->spare) FREE(state->backing, state->spare);
+    FREE(state->backing, state);
+}
 
-                block = (Block*)virtual_commit(state->mem+state->committed, commit_size);
-                block->next = state->free_block;
-                block->prev = nullptr;
-                block->size = commit_size;
+Allocator tl_block_allocator(i64 block_size, Allocator backing, const char *name)
+{
+    BlockAllocatorState *state = ALLOC_T(backing, BlockAllocatorState) {
+        .block_size = block_size,
+        .backing = backing,
+    };
+
+    Allocator alloc{ state, tl_block_alloc };
+    state->node = register_allocator(alloc, name);
+    return alloc;
+}
+
+Allocator malloc_allocator()
+{
+    // NOTE(jesper): every malloc_allocator is the same process heap, they share
+    // the one state and registration
+    static i32 registered = 0;
+
+    Allocator alloc{ &malloc_state, malloc_alloc };
+    if (atomic_compare_exchange(&registered, 0, 1)) register_allocator(alloc, "malloc");
+    return alloc;
+}
+
+
+void* vm_freelist_alloc_unlocked(VMFreeListState *state, i64 size, u8 alignment)
+{
+    using Header = VMFreeListState::Header;
+    using Block = VMFreeListState::Block;
+
+    u8 header_size = sizeof(Header);
+    i64 minimum_size = sizeof(Block);
+    i64 required_size = size+alignment+header_size-1;
+
+    auto block = state->free_block;
+    while (block && block->size < required_size) block = block->next;
+    if (!block) {
+        i64 commit_size = ROUND_TO(required_size, state->page_size);
+        if (state->committed + commit_size > state->reserved) {
+            LOG_ERROR("virtual size exceeded");
+            return nullptr;
+        }
+
+        block = (Block*)(state->flags & M_HUGE_PAGES_EXPLICIT
+            ? state->mem+state->committed
+            : virtual_commit(state->mem+state->committed, commit_size));
+        if (!block) return nullptr;
 
-                if (state->free_block) state->free_block->prev = block;
-                state->free_block = block;
+        block->next = state->free_block;
+        block->prev = nullptr;
+        block->size = commit_size;
 
-                state->committed += commit_size;
+        if (state->free_block) state->free_block->prev = block;
+        state->free_block = block;
+
+        state->committed += commit_size;
 
 #if M_DEBUG_VIRTUAL_HEAP_ALLOC
-                LOG_INFO("commmitted new block [%p] of size %lld, total committed: %lld", block, commit_size, state->committed);
+        LOG_INFO("commmitted new block [%p] of size %lld, total committed: %lld", block, commit_size, state->committed);
 #endif
-            }
+    }
 
-            void *ptr;
-            i64 total_size = required_size;
-            if (block->size-required_size < minimum_size) {
+    void *ptr;
+    i64 total_size = required_size;
+    if (block->size-required_size < minimum_size) {
 #if M_DEBUG_VIRTUAL_HEAP_ALLOC
-                LOG_INFO("popping block [%p] of size %d", block, block->size);
+        LOG_INFO("popping block [%p] of size %d", block, block->size);
 #endif
-                if (state->free_block == block) {
-                    state->free_block = block->next;
-                }
-
-                if (block->next) block->next->prev = block->prev;
-                if (block->prev) block->prev->next = block->next;
-                total_size = block->size;
-                ptr = block;
-            } else {
-                ptr = (u8*)block + block->size - required_size;
-                block->size -= required_size;
+        if (state->free_block == block) {
+            state->free_block = block->next;
+        }
+
+        if (block->next) block->next->prev = block->prev;
+        if (block->prev) block->prev->next = block->next;
+        total_size = block->size;
+        ptr = block;
+
+        if (block->size < state->page_size) state->small_free -= block->size;
+    } else {
+        ptr = (u8*)block + block->size - required_size;
+        if (block->size < state->page_size) state->small_free -= block->size;
+        block->size -= required_size;
+        if (block->size < state->page_size) state->small_free += block->size;
 #if M_DEBUG_VIRTUAL_HEAP_ALLOC
-                LOG_INFO("shrinking block [%p] by %d bytes, %lld remain", block, required_size, block->size);
+        LOG_INFO("shrinking block [%p] by %d bytes, %lld remain", block, required_size, block->size);
 #endif
-            }
+    }
 
-            void *aligned_ptr = align_ptr(ptr, alignment, header_size);
+    void *aligned_ptr = align_ptr(ptr, alignment, header_size);
 
-            Header* header = get_header<Header>(aligned_ptr);
-            header->offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
-            header->alignment = alignment;
-            header->total_size = total_size;
+    Header* header = get_header<Header>(aligned_ptr);
+    header->offset = (u8)((size_t)aligned_ptr - (size_t)ptr);
+    header->alignment = alignment;
+    header->cache_class = 0;
+    header->total_size = total_size;
+
+    state->used += total_size;
+    state->peak = MAX(state->peak, state->used);
+    state->alloc_count++;
 
 #if M_DEBUG_VIRTUAL_HEAP_ALLOC
-            for (Block *b = state->free_block; b; b = b->next) {
-                LOG_RAW("\t\t[%p] size: %lld, prev [%p], next [%p]\n", b, b->size, b->prev, b->next);
-            }
+    for (Block *b = state->free_block; b; b = b->next) {
+        LOG_RAW("\t\t[%p] size: %lld, prev [%p], next [%p]\n", b, b->size, b->prev, b->next);
+    }
+
+    LOG_INFO("allocated [%p]", aligned_ptr);
+#endif
 
-            LOG_INFO("allocated [%p]", aligned_ptr);
+    return aligned_ptr;
+}
+
+void vm_freelist_free_unlocked(VMFreeListState *state, const void *ptr)
+{
+    using Header = VMFreeListState::Header;
+    using Block = VMFreeListState::Block;
+
+    // TODO(jesper): do we try to expand neighbor free blocks to reduce fragmentation?
+    Header* header = get_header<Header>(ptr);
+    void *unaligned_ptr = (void*)((size_t)ptr - header->offset);
+    i64 total_size = header->total_size;
+    state->used -= total_size;
+    if (total_size < state->page_size) state->small_free += total_size;
+
+    auto block = (Block*)unaligned_ptr;
+    block->size = total_size;
+    block->next = state->free_block;
+    block->prev = nullptr;
+
+    if (state->free_block) state->free_block->prev = block;
+    state->free_block = block;
+
+#if M_DEBUG_VIRTUAL_HEAP_ALLOC
+    LOG_INFO("inserting free block [%p] size %lld", block, block->size);
+    for (Block *b = state->free_block; b; b = b->next) {
+        LOG_RAW("\t\t[%p] size: %lld, prev [%p], next [%p]\n", b, b->size, b->prev, b->next);
+    }
+    LOG_INFO("freed [%p]", ptr);
 #endif
+}
 
-            return aligned_ptr;
+void* vm_freelist_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+{
+    auto state = (VMFreeListState*)v_state;
+    switch (cmd) {
+    case M_ALLOC: {
+            lock_mutex(state->mutex);
+            defer { unlock_mutex(state->mutex); };
+            return vm_freelist_alloc_unlocked(state, size, alignment);
         } break;
     case M_INFO: {
             auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
             lock_mutex(state->mutex);
             defer { unlock_mutex(state->mutex); };
 
-            i64 free_size = 0;
-            for (VMFreeListState::Block *block = state->free_block; block; block = block->next) {
-                free_size += block->size;
-            }
+            // NOTE(jesper): every committed byte is either handed out or in a free block
+            i64 free_size = state->committed - state->used;
 
             info->size = state->reserved;
-            info->used = state->committed - free_size;
+            info->used = state->used;
+            info->peak = state->peak;
+            info->committed = state->committed;
+            info->alloc_count = state->alloc_count;
+            info->fragmentation = free_size > 0 ? (f32)state->small_free / (f32)free_size : 0.0f;
+            info->flags = state->flags;
+            info->numa_node = state->numa_node;
         } break;
     case M_FREE: {
             if (!old_ptr) break;
 
             lock_mutex(state->mutex);
             defer { unlock_mutex(state->mutex); };
-
-            // TODO(jesper): do we try to expand neighbor free blocks to reduce fragmentation?
-            Header* header = get_header<Header>(old_ptr);
-            void *unaligned_ptr = (void*)((size_t)old_ptr - header->offset);
-            i64 total_size = header->total_size;
-
-            auto block = (Block*)unaligned_ptr;
-            block->size = total_size;
-            block->next = state->free_block;
-            block->prev = nullptr;
-
-            if (state->free_block) state->free_block->prev = block;
-            state->free_block = block;
-
-#if M_DEBUG_VIRTUAL_HEAP_ALLOC
-            LOG_INFO("inserting free block [%p] size %lld", block, block->size);
-            for (Block *b = state->free_block; b; b = b->next) {
-                LOG_RAW("\t\t[%p] size: %lld, prev [%p], next [%p]\n", b, b->size, b->prev, b->next);
-            }
-            LOG_INFO("freed [%p]", old_ptr);
-#endif
-
+            vm_freelist_free_unlocked(state, old_ptr);
     } break;
     case M_REALLOC: {
         // TODO(jesper): if size < old_size, shrink the allocation and push the free block to the list
@@ -496,3 +1410,771 @@ void* vm_freelist_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_
 
     return nullptr;
 }
+
+i32 vm_freelist_alloc_batch(VMFreeListState *state, i64 size, u8 alignment, u8 cache_class, void **out, i32 count)
+{
+    using Header = VMFreeListState::Header;
+
+    lock_mutex(state->mutex);
+    defer { unlock_mutex(state->mutex); };
+
+    i32 allocated = 0;
+    for (; allocated < count; allocated++) {
+        void *ptr = vm_freelist_alloc_unlocked(state, size, alignment);
+        if (!ptr) break;
+
+        get_header<Header>(ptr)->cache_class = cache_class;
+        out[allocated] = ptr;
+    }
+
+    return allocated;
+}
+
+void vm_freelist_free_batch(VMFreeListState *state, void **ptrs, i32 count)
+{
+    lock_mutex(state->mutex);
+    defer { unlock_mutex(state->mutex); };
+
+    for (i32 i = 0; i < count; i++) vm_freelist_free_unlocked(state, ptrs[i]);
+}
+
+struct TlCacheAllocatorState {
+    VMFreeListState *backing;
+};
+
+struct TlCache {
+    struct Magazine {
+        i32 count;
+        void *blocks[M_TL_CACHE_MAGAZINE];
+    };
+
+    TlCacheAllocatorState *owner;
+    Magazine magazines[M_TL_CACHE_CLASSES];
+
+    void flush()
+    {
+        if (!owner) return;
+        for (Magazine &mag : magazines) {
+            if (mag.count > 0) vm_freelist_free_batch(owner->backing, mag.blocks, mag.count);
+            mag.count = 0;
+        }
+    }
+
+    ~TlCache() { flush(); }
+};
+
+thread_local TlCache tl_caches[M_TL_CACHE_MAX_ALLOCATORS];
+thread_local i32 tl_cache_next_evict = 0;
+
+i64 tl_cache_class_size(i32 cache_class)
+{
+    return (i64)M_TL_CACHE_MIN_SIZE << cache_class;
+}
+
+i32 tl_cache_class_of(i64 size)
+{
+    i32 cache_class = 0;
+    while (cache_class < M_TL_CACHE_CLASSES && tl_cache_class_size(cache_class) < size) cache_class++;
+    return cache_class;
+}
+
+TlCache* tl_cache_of(TlCacheAllocatorState *state)
+{
+    for (TlCache &cache : tl_caches) {
+        if (cache.owner == state) return &cache;
+        if (cache.owner == nullptr) {
+            cache.owner = state;
+            return &cache;
+        }
+    }
+
+    // NOTE(jesper): more cached allocators in use on this thread than we have
+    // caches for; hand back the cached blocks of one of them to its backing
+    // allocator and take over its slot
+    TlCache *cache = &tl_caches[tl_cache_next_evict];
+    tl_cache_next_evict = (tl_cache_next_evict+1) % M_TL_CACHE_MAX_ALLOCATORS;
+
+    cache->flush();
+    cache->owner = state;
+    return cache;
+}
+
+void* tl_cache_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+{
+    using Header = VMFreeListState::Header;
+
+    auto state = (TlCacheAllocatorState*)v_state;
+    Allocator backing{ state->backing, vm_freelist_alloc };
+
+    switch (cmd) {
+    case M_ALLOC: {
+        i32 cache_class = tl_cache_class_of(size);
+        if (alignment > M_DEFAULT_ALIGN || cache_class >= M_TL_CACHE_CLASSES) {
+            return ALLOC_A(backing, size, alignment);
+        }
+
+        TlCache *cache = tl_cache_of(state);
+        TlCache::Magazine *mag = &cache->magazines[cache_class];
+        if (mag->count == 0) {
+            mag->count = vm_freelist_alloc_batch(
+                state->backing,
+                tl_cache_class_size(cache_class), M_DEFAULT_ALIGN,
+                (u8)(cache_class+1),
+                mag->blocks, M_TL_CACHE_BATCH);
+            if (mag->count == 0) return nullptr;
+        }
+
+        return mag->blocks[--mag->count];
+        }
+    case M_FREE: {
+        if (!old_ptr) return nullptr;
+
+        Header *header = get_header<Header>(old_ptr);
+        if (header->cache_class == 0) {
+            FREE(backing, old_ptr);
+            return nullptr;
+        }
+
+        TlCache *cache = tl_cache_of(state);
+        TlCache::Magazine *mag = &cache->magazines[header->cache_class-1];
+        if (mag->count == M_TL_CACHE_MAGAZINE) {
+            // NOTE(jesper): flush the oldest half of the magazine, keeping the
+            // most recently freed (and most likely to still be in cache) blocks
+            vm_freelist_free_batch(state->backing, mag->blocks, M_TL_CACHE_BATCH);
+            mag->count -= M_TL_CACHE_BATCH;
+            memmove(mag->blocks, mag->blocks+M_TL_CACHE_BATCH, mag->count*sizeof mag->blocks[0]);
+        }
+
+        mag->blocks[mag->count++] = (void*)old_ptr;
+        return nullptr;
+        }
+    case M_REALLOC: {
+        if (old_ptr) {
+            Header *header = get_header<Header>(old_ptr);
+            if (header->cache_class > 0 &&
+                alignment <= M_DEFAULT_ALIGN &&
+                size <= tl_cache_class_size(header->cache_class-1))
+            {
+                return (void*)old_ptr;
+            }
+        }
+
+        void *nptr = tl_cache_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        if (old_ptr == nullptr) return nptr;
+
+        if (nptr && size > 0 && old_size > 0) memcpy(nptr, old_ptr, MIN(old_size, size));
+        tl_cache_alloc(v_state, M_FREE, old_ptr, 0, 0, 0);
+        return nptr;
+        }
+    case M_EXTEND: {
+        if (old_ptr) {
+            Header *header = get_header<Header>(old_ptr);
+            if (header->cache_class > 0 &&
+                alignment <= M_DEFAULT_ALIGN &&
+                size <= tl_cache_class_size(header->cache_class-1))
+            {
+                return (void*)old_ptr;
+            }
+        }
+
+        return tl_cache_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        }
+    case M_INFO:
+        // NOTE(jesper): blocks held in the thread caches count as used by the
+        // backing allocator, the cache has no memory of its own
+        return vm_freelist_alloc(state->backing, M_INFO, old_ptr, old_size, size, alignment);
+    case M_RESET:
+        LOG_ERROR("unsupported command called for tl_cache_allocator: reset");
+        return nullptr;
+    }
+
+    PANIC("unhandled allocator procedure: %d", cmd);
+    return nullptr;
+}
+
+Allocator tl_cache_allocator(Allocator vm_freelist, const char *name)
+{
+    PANIC_IF(vm_freelist.proc != vm_freelist_alloc, "tl_cache_allocator requires a vm_freelist_allocator backing");
+
+    TlCacheAllocatorState *state = (TlCacheAllocatorState*)malloc(sizeof *state);
+    *state = { .backing = (VMFreeListState*)vm_freelist.state };
+
+    Allocator alloc{ state, tl_cache_alloc };
+    register_allocator(alloc, name);
+    return alloc;
+}
+
+i64 slab_class_size(i32 size_class)
+{
+    return (i64)M_SLAB_MIN_SIZE << size_class;
+}
+
+i32 slab_class_of(i64 size, u8 alignment)
+{
+    i64 required = MAX(size, (i64)alignment);
+
+    i32 size_class = 0;
+    while (size_class < M_SLAB_CLASSES && slab_class_size(size_class) < required) size_class++;
+    return size_class;
+}
+
+i64 slab_first_object_offset(i32 size_class)
+{
+    i64 size = slab_class_size(size_class);
+    return ((i64)sizeof(SlabAllocatorState::Slab) + size-1) & ~(size-1);
+}
+
+i64 slab_class_capacity(i32 size_class)
+{
+    return (M_SLAB_SIZE - slab_first_object_offset(size_class)) / slab_class_size(size_class);
+}
+
+i32 slab_run_bin(i64 run_size)
+{
+    i32 bin = 0;
+    while (((i64)M_SLAB_SIZE << bin) < run_size) bin++;
+    return bin;
+}
+
+SlabAllocatorState::Slab* slab_of(const void *ptr)
+{
+    return (SlabAllocatorState::Slab*)((size_t)ptr & ~(size_t)(M_SLAB_SIZE-1));
+}
+
+// NOTE(jesper): expects state->mutex to be held by the caller
+SlabAllocatorState::Slab* slab_acquire_run(SlabAllocatorState *state, i32 bin)
+{
+    using Slab = SlabAllocatorState::Slab;
+    PANIC_IF(bin >= M_SLAB_RUN_BINS, "slab run bin out of range: %d", bin);
+
+    i64 run_size = (i64)M_SLAB_SIZE << bin;
+
+    // NOTE(jesper): the run is only taken off the free list or the unused range
+    // once its pages are committed, so a failed commit leaves the state as it was
+    Slab *run = state->free_runs[bin];
+    if (run) {
+        if (!virtual_commit(run, run_size)) return nullptr;
+        state->free_runs[bin] = run->next;
+        state->committed += run_size - MIN(run_size, (i64)state->page_size);
+    } else {
+        if (state->next_run + run_size > state->end) {
+            LOG_ERROR("virtual size exceeded");
+            return nullptr;
+        }
+
+        run = (Slab*)state->next_run;
+        if (!virtual_commit(run, run_size)) return nullptr;
+        state->next_run += run_size;
+        state->committed += run_size;
+    }
+
+    *run = { .run_size = run_size };
+    return run;
+}
+
+// NOTE(jesper): expects state->mutex to be held by the caller. The first page
+// of the run stays committed to hold the free list link, the rest of its pages
+// are returned to the OS until the run is reused
+void slab_release_run(SlabAllocatorState *state, SlabAllocatorState::Slab *run)
+{
+    i64 run_size = run->run_size;
+    if (run_size > state->page_size) {
+        virtual_decommit((u8*)run + state->page_size, run_size - state->page_size);
+        state->committed -= run_size - state->page_size;
+    }
+
+    i32 bin = slab_run_bin(run_size);
+    run->next = state->free_runs[bin];
+    state->free_runs[bin] = run;
+}
+
+void slab_push_partial(SlabAllocatorState::SizeClass *sc, SlabAllocatorState::Slab *slab)
+{
+    slab->prev = nullptr;
+    slab->next = sc->partial;
+    if (sc->partial) sc->partial->prev = slab;
+    sc->partial = slab;
+}
+
+void slab_remove_partial(SlabAllocatorState::SizeClass *sc, SlabAllocatorState::Slab *slab)
+{
+    if (slab->prev) slab->prev->next = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+    if (sc->partial == slab) sc->partial = slab->next;
+    slab->next = slab->prev = nullptr;
+}
+
+bool slab_is_full(SlabAllocatorState::Slab *slab)
+{
+    return !slab->free && slab->bump + slab_class_size(slab->size_class) > slab->end;
+}
+
+bool slab_fits(const void *ptr, i64 size, u8 alignment)
+{
+    auto slab = slab_of(ptr);
+    if (slab->size_class >= 0) return slab_class_of(size, alignment) == slab->size_class;
+    return size + M_SLAB_LARGE_OFFSET <= slab->run_size && alignment <= M_SLAB_LARGE_OFFSET;
+}
+
+void* slab_alloc_small(SlabAllocatorState *state, i32 size_class)
+{
+    using Slab = SlabAllocatorState::Slab;
+
+    SlabAllocatorState::SizeClass *sc = &state->classes[size_class];
+    i64 size = slab_class_size(size_class);
+
+    lock_mutex(sc->mutex);
+    defer { unlock_mutex(sc->mutex); };
+
+    Slab *slab = sc->partial;
+    if (!slab) {
+        GUARD_MUTEX(state->mutex) slab = slab_acquire_run(state, 0);
+        if (!slab) return nullptr;
+
+        slab->size_class = size_class;
+        slab->bump = (u8*)slab + slab_first_object_offset(size_class);
+        slab->end = (u8*)slab + M_SLAB_SIZE;
+
+        sc->slabs++;
+        slab_push_partial(sc, slab);
+    }
+
+    void *ptr;
+    if (slab->free) {
+        ptr = slab->free;
+        slab->free = *(void**)ptr;
+    } else {
+        ptr = slab->bump;
+        slab->bump += size;
+    }
+
+    slab->used++;
+    sc->used++;
+    sc->alloc_count++;
+
+    if (slab_is_full(slab)) slab_remove_partial(sc, slab);
+    return ptr;
+}
+
+void slab_free_small(SlabAllocatorState *state, SlabAllocatorState::Slab *slab, const void *ptr)
+{
+    SlabAllocatorState::SizeClass *sc = &state->classes[slab->size_class];
+
+    lock_mutex(sc->mutex);
+    defer { unlock_mutex(sc->mutex); };
+
+    bool was_full = slab_is_full(slab);
+
+    *(void**)ptr = slab->free;
+    slab->free = (void*)ptr;
+
+    slab->used--;
+    sc->used--;
+
+    if (was_full) slab_push_partial(sc, slab);
+
+    // NOTE(jesper): keep the last partial slab of the class around to avoid
+    // thrashing when a single allocation is repeatedly allocated and freed
+    if (slab->used == 0 && (sc->partial != slab || slab->next != nullptr)) {
+        slab_remove_partial(sc, slab);
+        sc->slabs--;
+
+        GUARD_MUTEX(state->mutex) slab_release_run(state, slab);
+    }
+}
+
+void* slab_alloc_large(SlabAllocatorState *state, i64 size)
+{
+    using Slab = SlabAllocatorState::Slab;
+    i32 bin = slab_run_bin(size + M_SLAB_LARGE_OFFSET);
+
+    lock_mutex(state->mutex);
+    defer { unlock_mutex(state->mutex); };
+
+    Slab *run = slab_acquire_run(state, bin);
+    if (!run) return nullptr;
+
+    run->size_class = -1;
+    state->large_count++;
+    state->large_used += run->run_size;
+    state->large_alloc_count++;
+
+    return (u8*)run + M_SLAB_LARGE_OFFSET;
+}
+
+void slab_free_large(SlabAllocatorState *state, SlabAllocatorState::Slab *run)
+{
+    lock_mutex(state->mutex);
+    defer { unlock_mutex(state->mutex); };
+
+    state->large_count--;
+    state->large_used -= run->run_size;
+    slab_release_run(state, run);
+}
+
+void* slab_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment)
+{
+    auto state = (SlabAllocatorState*)v_state;
+
+    switch (cmd) {
+    case M_ALLOC: {
+        i32 size_class = slab_class_of(size, alignment);
+        if (size_class < M_SLAB_CLASSES) return slab_alloc_small(state, size_class);
+
+        PANIC_IF(alignment > M_SLAB_LARGE_OFFSET, "unsupported alignment for large slab allocation: %d", alignment);
+        return slab_alloc_large(state, size);
+        }
+    case M_FREE: {
+        if (!old_ptr) return nullptr;
+
+        auto slab = slab_of(old_ptr);
+        if (slab->size_class >= 0) slab_free_small(state, slab, old_ptr);
+        else slab_free_large(state, slab);
+        return nullptr;
+        }
+    case M_REALLOC: {
+        if (old_ptr && slab_fits(old_ptr, size, alignment)) return (void*)old_ptr;
+
+        void *nptr = slab_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        if (old_ptr == nullptr) return nptr;
+
+        if (nptr && size > 0 && old_size > 0) memcpy(nptr, old_ptr, MIN(old_size, size));
+        slab_alloc(v_state, M_FREE, old_ptr, 0, 0, 0);
+        return nptr;
+        }
+    case M_EXTEND: {
+        if (old_ptr && slab_fits(old_ptr, size, alignment)) return (void*)old_ptr;
+        return slab_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        }
+    case M_INFO: {
+        auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
+        auto slab_info = size == sizeof(SlabAllocatorInfo) ? (SlabAllocatorInfo*)info : nullptr;
+
+        // NOTE(jesper): the counters are read without taking the class locks,
+        // a snapshot taken while other threads allocate may be off by the
+        // allocations in flight, but won't stall them
+        info->size = state->end - state->mem;
+        info->used = 0;
+        info->alloc_count = atomic_load(&state->large_alloc_count);
+        info->committed = atomic_load(&state->committed);
+
+        // NOTE(jesper): free slots in the slabs can only serve their own size
+        // class, they're what we count as fragmented
+        i64 slot_free = 0;
+        for (i32 i = 0; i < M_SLAB_CLASSES; i++) {
+            SlabAllocatorState::SizeClass *sc = &state->classes[i];
+            i64 slabs = atomic_load(&sc->slabs);
+            i64 used = atomic_load(&sc->used);
+            info->used += used * slab_class_size(i);
+            info->alloc_count += atomic_load(&sc->alloc_count);
+            slot_free += MAX(slabs * slab_class_capacity(i) - used, (i64)0) * slab_class_size(i);
+
+            if (slab_info) {
+                slab_info->classes[i] = {
+                    .size = slab_class_size(i),
+                    .slabs = slabs,
+                    .used = used,
+                    .capacity = slabs * slab_class_capacity(i),
+                };
+            }
+        }
+
+        i64 large_used = atomic_load(&state->large_used);
+        info->used += large_used;
+
+        i64 peak = state->peak;
+        while (info->used > peak && !atomic_compare_exchange(&state->peak, peak, info->used)) peak = state->peak;
+        info->peak = MAX(peak, info->used);
+
+        i64 free_size = info->committed - info->used;
+        info->fragmentation = free_size > 0 ? MIN((f32)slot_free / (f32)free_size, 1.0f) : 0.0f;
+
+        if (slab_info) {
+            slab_info->large_count = atomic_load(&state->large_count);
+            slab_info->large_used = large_used;
+        }
+        return nullptr;
+        }
+    case M_RESET:
+        LOG_ERROR("unsupported command called for slab_allocator: reset");
+        return nullptr;
+    }
+
+    PANIC("unhandled allocator procedure: %d", cmd);
+    return nullptr;
+}
+
+Allocator slab_allocator(i64 max_size, const char *name)
+{
+    // NOTE(jesper): over-reserve by a slab so that every slab can be aligned
+    // to M_SLAB_SIZE, which is how a pointer finds its slab header on free
+    i64 reserve_size = max_size + M_SLAB_SIZE;
+    u8 *mem = (u8*)virtual_reserve(reserve_size);
+    PANIC_IF(!mem, "failed to reserve memory for slab allocator");
+
+    u8 *aligned = (u8*)(((size_t)mem + M_SLAB_SIZE-1) & ~(size_t)(M_SLAB_SIZE-1));
+
+    SlabAllocatorState *state = (SlabAllocatorState*)malloc(sizeof *state);
+    *state = {
+        .mem = aligned,
+        .end = aligned + max_size,
+        .next_run = aligned,
+        .mutex = create_mutex(),
+        .page_size = get_page_size(),
+    };
+
+    for (auto &sc : state->classes) sc.mutex = create_mutex();
+
+    Allocator alloc{ state, slab_alloc };
+    register_allocator(alloc, name);
+    return alloc;
+}
+
+SlabAllocatorInfo get_slab_allocator_info(Allocator slab)
+{
+    PANIC_IF(slab.proc != slab_alloc, "allocator is not a slab_allocator");
+
+    SlabAllocatorInfo info{};
+    slab.proc(slab.state, M_INFO, &info, 0, sizeof info, 0);
+    return info;
+}
+
+// NOTE(jesper): expects state->mutex to be held by the caller
+TrackedCallsite* tracking_callsite(TrackingAllocatorState *state, MemCallsite callsite)
+{
+    if (!callsite.file) return &state->untracked;
+
+    u32 hash = (u32)(((size_t)callsite.file >> 3) ^ ((u32)callsite.line * 2654435761u));
+    for (i32 i = 0; i < M_TRACK_CALLSITES; i++) {
+        TrackedCallsite *site = &state->callsites[(hash + i) % M_TRACK_CALLSITES];
+        if (site->file == callsite.file && site->line == callsite.line) return site;
+
+        if (!site->file) {
+            // NOTE(jesper): keep a free slot around so that lookups terminate
+            if (state->callsite_count == M_TRACK_CALLSITES-1) break;
+
+            site->file = callsite.file;
+            site->line = callsite.line;
+            state->callsite_count++;
+            return site;
+        }
+    }
+
+    return &state->untracked;
+}
+
+void tracking_add(TrackingAllocatorState *state, TrackedCallsite *site, i64 size)
+{
+    site->count++;
+    site->bytes += size;
+    site->live_count++;
+    site->live_bytes += size;
+    site->peak_bytes = MAX(site->peak_bytes, site->live_bytes);
+
+    state->live_count++;
+    state->live_bytes += size;
+    state->peak_bytes = MAX(state->peak_bytes, state->live_bytes);
+    state->alloc_count++;
+}
+
+void tracking_remove(TrackingAllocatorState *state, TrackedCallsite *site, i64 size)
+{
+    site->live_count--;
+    site->live_bytes -= size;
+
+    state->live_count--;
+    state->live_bytes -= size;
+}
+
+u32 tracking_header_size(u8 alignment)
+{
+    // NOTE(jesper): the header is padded to the alignment so that the backing
+    // allocation stays aligned and can be reallocated in place
+    return MAX((u32)32, (u32)alignment);
+}
+
+// NOTE(jesper): the old size is taken from the allocation's header, which is
+// what the tracked counts were made with
+void* tracking_alloc(void *v_state, M_Proc cmd, const void *old_ptr, i64 /*old_size*/, i64 size, u8 alignment)
+{
+    using Header = TrackingAllocatorState::Header;
+    auto state = (TrackingAllocatorState*)v_state;
+
+    MemCallsite callsite = mem_callsite;
+    mem_callsite = {};
+
+    Allocator backing = state->backing;
+
+    switch (cmd) {
+    case M_ALLOC: {
+        u32 offset = tracking_header_size(alignment);
+        u8 *base = (u8*)backing.proc(backing.state, M_ALLOC, nullptr, 0, offset+size, alignment);
+        if (!base) return nullptr;
+
+        u8 *ptr = base + offset;
+        Header *header = get_header<Header>(ptr);
+        header->size = size;
+        header->offset = offset;
+        header->alignment = alignment;
+
+        GUARD_MUTEX(state->mutex) {
+            header->site = tracking_callsite(state, callsite);
+            tracking_add(state, header->site, size);
+        }
+        return ptr;
+        }
+    case M_FREE: {
+        if (!old_ptr) return nullptr;
+
+        Header *header = get_header<Header>(old_ptr);
+        GUARD_MUTEX(state->mutex) tracking_remove(state, header->site, header->size);
+
+        u8 *base = (u8*)old_ptr - header->offset;
+        backing.proc(backing.state, M_FREE, base, 0, 0, 0);
+        return nullptr;
+        }
+    case M_REALLOC:
+    case M_EXTEND: {
+        if (!old_ptr) {
+            mem_callsite = callsite;
+            return tracking_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+        }
+
+        Header *old_header = get_header<Header>(old_ptr);
+        if (old_header->alignment != alignment) {
+            mem_callsite = callsite;
+            void *ptr = tracking_alloc(v_state, M_ALLOC, nullptr, 0, size, alignment);
+            if (ptr && cmd == M_REALLOC) {
+                memcpy(ptr, old_ptr, MIN(old_header->size, size));
+                tracking_alloc(v_state, M_FREE, old_ptr, 0, 0, 0);
+            }
+            return ptr;
+        }
+
+        u32 offset = old_header->offset;
+        i64 old_tracked_size = old_header->size;
+        TrackedCallsite *old_site = old_header->site;
+
+        u8 *old_base = (u8*)old_ptr - offset;
+        u8 *base = (u8*)backing.proc(backing.state, cmd, old_base, offset+old_tracked_size, offset+size, alignment);
+        if (!base) return nullptr;
+
+        u8 *ptr = base + offset;
+        Header *header = get_header<Header>(ptr);
+        header->size = size;
+        header->offset = offset;
+        header->alignment = alignment;
+
+        GUARD_MUTEX(state->mutex) {
+            // NOTE(jesper): an out of place extend leaves the old allocation
+            // live until the caller frees it
+            if (cmd == M_REALLOC || base == old_base) tracking_remove(state, old_site, old_tracked_size);
+
+            header->site = tracking_callsite(state, callsite);
+            tracking_add(state, header->site, size);
+        }
+        return ptr;
+        }
+    case M_INFO: {
+        // NOTE(jesper): capacity, committed memory and fragmentation are the
+        // backing allocator's, usage is what was allocated through this one
+        auto info = (AllocatorInfo*)const_cast<void*>(old_ptr);
+        backing.proc(backing.state, M_INFO, info, 0, 0, 0);
+
+        GUARD_MUTEX(state->mutex) {
+            info->used = state->live_bytes;
+            info->peak = state->peak_bytes;
+            info->alloc_count = state->alloc_count;
+        }
+        return nullptr;
+        }
+    case M_RESET:
+        // NOTE(jesper): live counts are only known to be cleared by a full reset
+        // of the backing allocator, restore points leave them as is
+        backing.proc(backing.state, M_RESET, old_ptr, 0, 0, 0);
+        if (!old_ptr) {
+            GUARD_MUTEX(state->mutex) {
+                state->live_count = state->live_bytes = 0;
+                state->untracked.live_count = state->untracked.live_bytes = 0;
+                for (auto &site : state->callsites) site.live_count = site.live_bytes = 0;
+            }
+        }
+        return nullptr;
+    }
+
+    PANIC("unhandled allocator procedure: %d", cmd);
+    return nullptr;
+}
+
+Allocator tracking_allocator(Allocator backing, const char *name)
+{
+    TrackingAllocatorState *state = (TrackingAllocatorState*)malloc(sizeof *state);
+    memset(state, 0, sizeof *state);
+
+    state->backing = backing;
+    state->mutex = create_mutex();
+    state->untracked.file = "<untracked>";
+
+    Allocator alloc{ state, tracking_alloc };
+    register_allocator(alloc, name);
+    return alloc;
+}
+
+i32 get_tracked_callsites(Allocator tracking, TrackedCallsite *dst, i32 max_count)
+{
+    PANIC_IF(tracking.proc != tracking_alloc, "allocator is not a tracking_allocator");
+    auto state = (TrackingAllocatorState*)tracking.state;
+
+    // NOTE(jesper): insertion sort by live bytes, then by total bytes, keeping
+    // only the max_count largest callsites
+    i32 count = 0;
+    auto insert = [&](const TrackedCallsite &site) {
+        if (site.count == 0) return;
+
+        i32 i = count < max_count ? count++ : max_count;
+        while (i > 0 && (dst[i-1].live_bytes < site.live_bytes ||
+                         (dst[i-1].live_bytes == site.live_bytes && dst[i-1].bytes < site.bytes)))
+        {
+            if (i < max_count) dst[i] = dst[i-1];
+            i--;
+        }
+
+        if (i < max_count) dst[i] = site;
+    };
+
+    GUARD_MUTEX(state->mutex) {
+        insert(state->untracked);
+        for (const TrackedCallsite &site : state->callsites) insert(site);
+    }
+
+    return count;
+}
+
+void log_tracking_report(Allocator tracking, i32 max_callsites)
+{
+    PANIC_IF(tracking.proc != tracking_alloc, "allocator is not a tracking_allocator");
+    auto state = (TrackingAllocatorState*)tracking.state;
+
+    TrackedCallsite *sites = (TrackedCallsite*)malloc(max_callsites * sizeof *sites);
+    defer { free(sites); };
+
+    i32 count = get_tracked_callsites(tracking, sites, max_callsites);
+
+    i64 live_count, live_bytes, peak_bytes;
+    GUARD_MUTEX(state->mutex) {
+        live_count = state->live_count;
+        live_bytes = state->live_bytes;
+        peak_bytes = state->peak_bytes;
+    }
+
+    LOG_INFO("[mem] tracked allocations: %lld live bytes in %lld allocations, peak %lld bytes",
+             live_bytes, live_count, peak_bytes);
+
+    for (i32 i = 0; i < count; i++) {
+        TrackedCallsite *site = &sites[i];
+        LOG_INFO("[mem]   %s:%d: %lld live bytes in %lld allocations, peak %lld bytes, %lld bytes in %lld allocations total",
+                 site->file, site->line,
+                 site->live_bytes, site->live_count, site->peak_bytes,
+                 site->bytes, site->count);
+    }
+}
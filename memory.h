@@ -2,6 +2,7 @@
 #define MEMORY_H
 
 #include <new>
+#include <initializer_list>
 #include "core.h"
 
 extern "C" CRTIMP void* malloc(size_t size) NOTHROW;
@@ -20,6 +21,58 @@ extern "C" void* memmove(void *destination, const void *source, size_t num) NOTH
 #define M_SCRATCH_ARENAS 16
 #define M_DEFAULT_ALIGN 16
 
+#define M_TL_CACHE_CLASSES 8
+#define M_TL_CACHE_MIN_SIZE 16
+#define M_TL_CACHE_MAGAZINE 64
+#define M_TL_CACHE_BATCH 32
+#define M_TL_CACHE_MAX_ALLOCATORS 4
+
+#define M_SLAB_SIZE (64*KiB)
+#define M_SLAB_MIN_SIZE 16
+#define M_SLAB_CLASSES 10
+#define M_SLAB_RUN_BINS 32
+
+#define M_ARENA_POOL_CLASSES 32
+#define M_ARENA_POOL_MAX 64
+
+// NOTE(jesper): malloc_allocator allocations of at least this size get their
+// own virtual_map mapping, which is grown with virtual_remap instead of copied
+#define M_MALLOC_LARGE_SIZE (1*MiB)
+
+// NOTE(jesper): when enabled, the allocation macros record their __FILE__ and
+// __LINE__ in mem_callsite for a tracking_allocator to attribute allocations to
+#ifndef M_TRACK_ALLOCATIONS
+#define M_TRACK_ALLOCATIONS 0
+#endif
+
+#define M_TRACK_CALLSITES 1024
+
+// NOTE(jesper): when enabled, tl_linear_allocator and linear_allocator put a
+// redzone after every allocation that is checked for overruns on M_RESET, and
+// fill the memory released by M_RESET with M_ARENA_POISON_BYTE to make use
+// after restore easy to spot. Under ASan the redzones and released memory are
+// poisoned as well
+#ifndef M_DEBUG_ARENAS
+#define M_DEBUG_ARENAS 0
+#endif
+
+#define M_ARENA_POISON_BYTE 0xcd
+#define M_ARENA_REDZONE_BYTE 0xfd
+
+#define M_HUGE_PAGE_SIZE (2*MiB)
+
+enum VirtualMemoryFlags : u32 {
+    // NOTE(jesper): transparent huge pages, the reserved range is huge page
+    // aligned and advised for huge pages but may still be backed by small pages
+    M_HUGE_PAGES          = 1 << 0,
+    // NOTE(jesper): pages from the pre-allocated huge page pool, committed on
+    // reserve. Falls back to M_HUGE_PAGES if the pool can't cover the range
+    M_HUGE_PAGES_EXPLICIT = 1 << 1,
+    // NOTE(jesper): prefer the NUMA node of the reserving thread for all pages
+    // in the range. Only supported on linux
+    M_NUMA_LOCAL          = 1 << 2,
+};
+
 enum M_Proc { M_ALLOC, M_FREE, M_EXTEND, M_REALLOC, M_RESET, M_INFO, };
 typedef void* allocate_t(void *state, M_Proc cmd, const void *old_ptr, i64 old_size, i64 size, u8 alignment);
 
@@ -33,9 +86,20 @@ struct Allocator {
 
 extern Allocator mem_dynamic;
 
+struct MemCallsite {
+    const char *file;
+    i32 line;
+};
+
+extern thread_local MemCallsite mem_callsite;
+
 #define ALLOCATOR(alloc) ((Allocator)(alloc))
 #define ALLOC_STATE(alloc) (((Allocator)(alloc)).state)
+#if M_TRACK_ALLOCATIONS
+#define ALLOC_PROC(alloc, ...) (mem_callsite = MemCallsite{ __FILE__, __LINE__ }, ((Allocator)(alloc)).proc(((Allocator)(alloc)).state, __VA_ARGS__))
+#else
 #define ALLOC_PROC(alloc, ...) (((Allocator)(alloc)).proc(((Allocator)(alloc)).state, __VA_ARGS__))
+#endif
 
 #define ALLOC(alloc, size)               ALLOC_PROC(alloc, M_ALLOC, nullptr, 0, size,      M_DEFAULT_ALIGN)
 #define ALLOC_A(alloc, size, align)      ALLOC_PROC(alloc, M_ALLOC, nullptr, 0, size,      align)
@@ -66,15 +130,62 @@ void init_default_allocators();
 
 i32 get_page_size();
 
-void* virtual_reserve(i64 size);
+// NOTE(jesper): numa_node receives the node the range was bound to when
+// M_NUMA_LOCAL is obtained, -1 otherwise
+void* virtual_reserve(i64 size, u32 flags = 0, u32 *obtained_flags = nullptr, i32 *numa_node = nullptr);
 void* virtual_commit(void *addr, i64 size);
-
-Allocator linear_allocator(i64 size);
+void virtual_decommit(void *addr, i64 size);
+
+// NOTE(jesper): committed read-write mappings. virtual_remap resizes a mapping
+// made by virtual_map without copying its contents where the platform allows,
+// returning nullptr if it can't be resized in place and may_move is false
+void* virtual_map(i64 size);
+void* virtual_remap(void *addr, i64 old_size, i64 size, bool may_move);
+void virtual_unmap(void *addr, i64 size);
+
+// NOTE(jesper): returns -1 if unknown, or if the range isn't bound to a node
+i32 current_numa_node();
+i32 virtual_numa_node(void *addr);
+
+// NOTE(jesper): the allocator constructors register the allocator in
+// mem_allocators under the given name, for get_allocator_snapshots. The name
+// must outlive the allocator. malloc_allocator shares a single state, and so a
+// single registration, between all its allocators
+Allocator linear_allocator(i64 size, u32 flags = 0, const char *name = "linear");
 Allocator malloc_allocator();
 
-Allocator tl_linear_allocator(i64 size);
+Allocator tl_linear_allocator(i64 size, u32 flags = 0, const char *name = "tl_linear");
 
-Allocator vm_freelist_allocator(i64 max_size);
+// NOTE(jesper): thread-local growable arena. Memory is bump allocated out of a
+// chain of blocks of at least block_size from the backing allocator, with a new
+// block chained in whenever the current one is exhausted. Resetting to a
+// restore point pops the blocks allocated after it, keeping the largest one
+// around for reuse by the next block
+Allocator tl_block_allocator(i64 block_size, Allocator backing, const char *name = "tl_block");
+
+Allocator vm_freelist_allocator(i64 max_size, u32 flags = 0, const char *name = "vm_freelist");
+
+// NOTE(jesper): thread-local front-end for a vm_freelist_allocator. Small
+// allocations are served from per-thread, per-size-class magazines that are
+// refilled from and flushed to the shared VMFreeListState in batches, so the
+// freelist mutex is only taken once every M_TL_CACHE_BATCH allocations.
+// Allocations above the largest size class, or with an alignment greater than
+// M_DEFAULT_ALIGN, are forwarded to the backing allocator
+Allocator tl_cache_allocator(Allocator vm_freelist, const char *name = "tl_cache");
+
+// NOTE(jesper): size-class segregated allocator carved out of a virtual_reserve
+// range. Allocations up to the largest size class are served in O(1) from
+// M_SLAB_SIZE slabs of same-sized objects; larger allocations get a
+// power-of-two run of slabs whose pages are returned to the OS on free, and
+// the run recycled for the next allocation of the same bin
+Allocator slab_allocator(i64 max_size, const char *name = "slab");
+
+// NOTE(jesper): wraps the backing allocator and records allocation counts,
+// total, live and peak bytes per callsite. Callsites are only known with
+// M_TRACK_ALLOCATIONS enabled, otherwise everything is attributed to a single
+// untracked entry. M_INFO reports the live and peak bytes allocated through it,
+// and the capacity and committed memory of the backing allocator
+Allocator tracking_allocator(Allocator backing, const char *name = "tracking");
 
 
 struct MArena : Allocator {
@@ -84,23 +195,93 @@ struct MArena : Allocator {
 
 struct AllocatorNode {
     AllocatorNode *next;
-    Allocator *arena;
+    Allocator alloc;
+    const char *name;
     i64 thread_owner;
+    i32 readers;
 };
 
 struct AllocatorInfo {
     i64 size;
     i64 used;
+    i64 peak;        // high-water mark of used
+    i64 committed;   // bytes of memory backing the allocator
+    i64 alloc_count; // allocations made over the allocator's lifetime
+
+    // NOTE(jesper): share of the free committed memory that is in blocks too
+    // small to serve a page sized allocation, 0 for allocators that can't fragment
+    f32 fragmentation;
+
+    u32 flags; // VirtualMemoryFlags obtained for the allocator's memory
+    i32 numa_node = -1; // node the allocator's memory is bound to with M_NUMA_LOCAL
 };
 
-extern AllocatorNode mem_allocators;
+struct AllocatorSnapshot {
+    const char *name;
+    i64 thread_owner;
+    AllocatorInfo info;
+};
+
+struct SlabAllocatorInfo : AllocatorInfo {
+    struct {
+        i64 size;
+        i64 slabs;
+        i64 used;
+        i64 capacity;
+    } classes[M_SLAB_CLASSES];
+
+    i64 large_count;
+    i64 large_used;
+};
 
-MArena tl_arena(i32 initial_size);
+struct TrackedCallsite {
+    const char *file;
+    i32 line;
+
+    i64 count;
+    i64 bytes;
+    i64 live_count;
+    i64 live_bytes;
+    i64 peak_bytes;
+};
 
+extern AllocatorNode mem_allocators;
+
+AllocatorNode* register_allocator(Allocator alloc, const char *name);
+void unregister_allocator(AllocatorNode *node);
+
+// NOTE(jesper): VirtualMemoryFlags for scratch arenas created from here on, e.g.
+// M_NUMA_LOCAL to place each thread's scratch arenas on its own NUMA node. Set
+// before any worker threads are started
+extern u32 mem_scratch_flags;
+
+// NOTE(jesper): acquires a growable arena from the global arena pool, or
+// creates one if the pool is empty for the size class of initial_size. The
+// arena must be returned to the pool with release_arena
+MArena tl_arena(i32 initial_size, const char *name = "arena");
+
+// NOTE(jesper): returns the lowest of the thread's M_SCRATCH_ARENAS scratch
+// arenas that isn't one of the conflicts, at a restore point of its current
+// position. Pass every allocator the caller may still write results into,
+// typically the output allocators it was given
+MArena tl_scratch_arena(const Allocator *conflicts, i32 count);
+MArena tl_scratch_arena(std::initializer_list<Allocator> conflicts);
 MArena tl_scratch_arena(Allocator conflict = {});
 void release_arena(MArena *arena);
 void restore_arena(MArena *arena);
 AllocatorInfo get_allocator_info(Allocator alloc);
+SlabAllocatorInfo get_slab_allocator_info(Allocator slab);
+
+i32 get_tracked_callsites(Allocator tracking, TrackedCallsite *dst, i32 max_count);
+void log_tracking_report(Allocator tracking, i32 max_callsites = 16);
+
+// NOTE(jesper): fills dst with the info of up to max_count registered
+// allocators, returning the number written. Thread-local allocators are read
+// without synchronising with their owning thread, so their numbers may be
+// slightly stale, but unregister_allocator waits for any snapshot reading them
+// before they're destroyed
+i32 get_allocator_snapshots(AllocatorSnapshot *dst, i32 max_count);
+void log_allocator_report();
 
 
 struct SArena {
@@ -131,6 +312,13 @@ struct VMFreeListState {
         i64 size;
     };
 
+    struct Header {
+        u64 total_size;
+        u8 offset;
+        u8 alignment;
+        u8 cache_class;
+    };
+
     u8 *mem;
     i64 reserved;
     i64 committed;
@@ -139,8 +327,154 @@ struct VMFreeListState {
     Mutex *mutex;
 
     i32 page_size;
+    u32 flags;
+
+    i64 used;
+    i64 peak;
+    i64 alloc_count;
+    i64 small_free; // free bytes in blocks smaller than a page
+    i32 numa_node;
+};
+
+#define POOL_CHUNK_SIZE 64
+
+template<typename T>
+struct PoolHandle {
+    i32 index;
+    u32 gen;
+
+    bool operator==(const PoolHandle<T> &rhs) const = default;
+    bool operator!=(const PoolHandle<T> &rhs) const = default;
+
+    explicit operator bool() const { return gen != 0; }
+};
+
+// NOTE(jesper): items are stored in chunks of POOL_CHUNK_SIZE that are never
+// moved or freed until pool_destroy, so pointers into the pool stay valid while
+// the item is alive. Freed slots are threaded onto an intrusive free list and
+// reused in LIFO order with their generation bumped, which invalidates any
+// outstanding handles to the old item
+template<typename T>
+struct Pool {
+    struct Slot {
+        alignas(T) u8 storage[sizeof(T)];
+        i32 next_free;
+        u32 gen;
+    };
+
+    Slot **chunks = nullptr;
+    i32 chunk_count = 0;
+    i32 chunk_capacity = 0;
+
+    i32 count = 0;
+    i32 free_head = -1;
+
+    Allocator alloc = {};
 };
 
+template<typename T>
+typename Pool<T>::Slot* pool_slot(Pool<T> *pool, i32 index)
+{
+    return &pool->chunks[index / POOL_CHUNK_SIZE][index % POOL_CHUNK_SIZE];
+}
+
+// NOTE(jesper): a slot's gen is odd while the slot holds a live item
+template<typename T>
+bool pool_slot_alive(typename Pool<T>::Slot *slot)
+{
+    return slot->gen & 1;
+}
+
+template<typename T>
+void pool_grow(Pool<T> *pool)
+{
+    using Slot = typename Pool<T>::Slot;
+    if (!pool->alloc.proc) pool->alloc = mem_dynamic;
+
+    if (pool->chunk_count == pool->chunk_capacity) {
+        i32 old_capacity = pool->chunk_capacity;
+        pool->chunk_capacity = MAX(4, old_capacity*2);
+        pool->chunks = REALLOC_ARR(pool->alloc, Slot*, pool->chunks, old_capacity, pool->chunk_capacity);
+    }
+
+    Slot *chunk = ALLOC_ARR(pool->alloc, Slot, POOL_CHUNK_SIZE);
+    i32 first = pool->chunk_count * POOL_CHUNK_SIZE;
+    for (i32 i = 0; i < POOL_CHUNK_SIZE; i++) {
+        chunk[i].next_free = i < POOL_CHUNK_SIZE-1 ? first+i+1 : pool->free_head;
+        chunk[i].gen = 0;
+    }
+
+    pool->chunks[pool->chunk_count++] = chunk;
+    pool->free_head = first;
+}
+
+template<typename T>
+PoolHandle<T> pool_add(Pool<T> *pool, T value)
+{
+    if (pool->free_head == -1) pool_grow(pool);
+
+    i32 index = pool->free_head;
+    auto slot = pool_slot(pool, index);
+    pool->free_head = slot->next_free;
+    pool->count++;
+
+    slot->gen++;
+    new (slot->storage) T(static_cast<T&&>(value));
+    return PoolHandle<T>{ index, slot->gen };
+}
+
+template<typename T>
+PoolHandle<T> pool_alloc(Pool<T> *pool)
+{
+    return pool_add(pool, T{});
+}
+
+template<typename T>
+T* pool_get(Pool<T> *pool, PoolHandle<T> handle)
+{
+    if (handle.index < 0 || handle.index >= pool->chunk_count*POOL_CHUNK_SIZE) return nullptr;
+
+    auto slot = pool_slot(pool, handle.index);
+    if (slot->gen != handle.gen || !pool_slot_alive<T>(slot)) return nullptr;
+    return (T*)slot->storage;
+}
+
+template<typename T>
+bool pool_free(Pool<T> *pool, PoolHandle<T> handle)
+{
+    T *item = pool_get(pool, handle);
+    if (!item) return false;
+
+    item->~T();
+
+    auto slot = pool_slot(pool, handle.index);
+    slot->gen++;
+    slot->next_free = pool->free_head;
+    pool->free_head = handle.index;
+    pool->count--;
+    return true;
+}
+
+template<typename T>
+void pool_destroy(Pool<T> *pool)
+{
+    for (i32 c = 0; c < pool->chunk_count; c++) {
+        for (i32 i = 0; i < POOL_CHUNK_SIZE; i++) {
+            auto slot = &pool->chunks[c][i];
+            if (pool_slot_alive<T>(slot)) ((T*)slot->storage)->~T();
+        }
+
+        FREE(pool->alloc, pool->chunks[c]);
+    }
+
+    if (pool->chunk_capacity > 0) FREE(pool->alloc, pool->chunks);
+
+    pool->chunks = nullptr;
+    pool->chunk_count = pool->chunk_capacity = 0;
+    pool->count = 0;
+    pool->free_head = -1;
+}
+
 struct MemoryBuffer {
     u8 *data;
     i32 size;
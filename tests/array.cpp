@@ -223,6 +223,92 @@ TEST_PROC(dynamic_array__reserve)
     ASSERT(arr.capacity >= arr.count);
 }
 
+TEST_PROC(dynamic_array__grow_past_large_alloc_preserves_contents)
+{
+    DynamicArray<i32> arr{};
+
+    i32 count = 4 * M_MALLOC_LARGE_SIZE / (i32)sizeof(i32);
+    for (i32 i = 0; i < count; i++) array_add(&arr, i);
+
+    ASSERT(arr.count == count);
+    for (i32 i = 0; i < count; i++) ASSERT(arr[i] == i);
+
+    array_reset(&arr);
+}
+
+TEST_PROC(dynamic_array__grow_moves_non_trivial_elements)
+{
+    DynamicArray<TestType> arr{};
+    array_reserve(&arr, 3);
+
+    TestType::reset_counters();
+    for (i32 i = 0; i < 3; i++) array_add(&arr, TestType(i));
+    ASSERT(TestType::copy_constructor_calls == 0);
+    ASSERT(TestType::move_constructor_calls == 3);
+
+    TestType::reset_counters();
+    array_reserve(&arr, 64);
+    ASSERT(TestType::copy_constructor_calls == 0);
+    ASSERT(TestType::move_constructor_calls == 3);
+    ASSERT(TestType::destructor_calls == 3);
+
+    for (i32 i = 0; i < 3; i++) ASSERT(arr[i].value == i);
+    array_reset(&arr);
+}
+
+TEST_PROC(dynamic_array__emplace_constructs_in_place)
+{
+    DynamicArray<TestType> arr{};
+    array_reserve(&arr, 4);
+
+    TestType::reset_counters();
+    TestType *e = array_emplace(&arr, 5);
+    ASSERT(e == &arr[0] && e->value == 5);
+    ASSERT(arr.count == 1);
+    ASSERT(TestType::constructor_calls == 1);
+    ASSERT(TestType::copy_constructor_calls == 0);
+    ASSERT(TestType::move_constructor_calls == 0);
+
+    array_reset(&arr);
+}
+
+TEST_PROC(dynamic_array__insert_shifts_by_move)
+{
+    DynamicArray<TestType> arr{};
+    array_reserve(&arr, 8);
+    for (i32 i = 0; i < 3; i++) array_add(&arr, TestType(i));
+
+    TestType::reset_counters();
+    array_insert(&arr, 0, TestType(9));
+    ASSERT(TestType::copy_constructor_calls == 0);
+    ASSERT(TestType::copy_assignment_calls == 0);
+    ASSERT(TestType::move_constructor_calls == 2);
+    ASSERT(TestType::move_assignment_calls == 2);
+
+    i32 expected[] = { 9, 0, 1, 2 };
+    ASSERT(arr.count == ARRAY_COUNT(expected));
+    for (i32 i = 0; i < arr.count; i++) ASSERT(arr[i].value == expected[i]);
+
+    array_reset(&arr);
+}
+
+TEST_PROC(dynamic_array__insert_many_keeps_order)
+{
+    DynamicArray<i32> arr{};
+    array_append(&arr, { 1, 2, 3, 4, 5 });
+
+    i32 ints[] = { 7, 8, 9 };
+    array_insert(&arr, 1, ints, ARRAY_COUNT(ints));
+
+    i32 expected[] = { 1, 7, 8, 9, 2, 3, 4, 5 };
+    ASSERT(arr == ARRAY(expected));
+
+    array_insert(&arr, 8, ARRAY(ints));
+    ASSERT(arr.count == 11 && arr[8] == 7 && arr[10] == 9);
+
+    array_reset(&arr);
+}
+
 TEST_PROC(dynamic_array__resize)
 {
     DynamicArray<i32> arr{};
@@ -459,6 +545,149 @@ TEST_PROC(fixed_array__data_pointer_integrity)
     ASSERT(arr1.data == original_data);
 }
 
+TEST_PROC(small_array__stays_inline_until_full)
+{
+    SmallArray<i32, 4> arr;
+    ASSERT(arr.is_inline() && arr.capacity == 4);
+
+    for (i32 i = 0; i < 4; i++) array_add(&arr, i);
+    ASSERT(arr.is_inline() && arr.alloc.proc == nullptr);
+
+    array_add(&arr, 4);
+    ASSERT(!arr.is_inline());
+    ASSERT(arr.count == 5 && arr.capacity >= 5);
+    for (i32 i = 0; i < arr.count; i++) ASSERT(arr[i] == i);
+
+    array_reset(&arr);
+    ASSERT(arr.is_inline() && arr.count == 0 && arr.capacity == 4);
+}
+
+TEST_PROC(small_array__copy_and_move_keep_own_storage)
+{
+    SmallArray<TestType, 2> a;
+    array_add(&a, TestType(1));
+
+    SmallArray<TestType, 2> b = a;
+    ASSERT(b.is_inline() && b.count == 1 && b[0].value == 1);
+
+    SmallArray<TestType, 2> c = RMOV(b);
+    ASSERT(c.is_inline() && c.count == 1 && c[0].value == 1);
+    ASSERT(b.is_inline() && b.count == 0);
+
+    array_add(&a, TestType(2));
+    array_add(&a, TestType(3));
+    ASSERT(!a.is_inline());
+
+    TestType *spilled = a.data;
+    c = RMOV(a);
+    ASSERT(c.data == spilled && c.count == 3 && c[2].value == 3);
+    ASSERT(a.is_inline() && a.count == 0);
+
+    array_reset(&c);
+}
+
+TEST_PROC(small_array__copy_assign_destroys_old_elements)
+{
+    TestType::reset_counters();
+
+    {
+        SmallArray<TestType, 2> a;
+        for (i32 i = 0; i < 3; i++) array_add(&a, TestType(i));
+
+        SmallArray<TestType, 2> b(linear_allocator(4096));
+        for (i32 i = 0; i < 3; i++) array_add(&b, TestType(10+i));
+
+        b = a;
+        ASSERT(b.count == 3 && b[0].value == 0 && b[2].value == 2);
+        ASSERT(b.alloc.proc == a.alloc.proc && b.alloc.state == a.alloc.state);
+        ASSERT(b.data != a.data);
+    }
+
+    i32 constructed = TestType::constructor_calls + TestType::copy_constructor_calls + TestType::move_constructor_calls;
+    ASSERT(constructed == TestType::destructor_calls);
+}
+
+TEST_PROC(small_array__interops_with_array_procedures)
+{
+    SmallArray<i32, 8> arr = { 5, 3, 1, 4, 2 };
+
+    array_sort(arr);
+    i32 sorted[] = { 1, 2, 3, 4, 5 };
+    ASSERT(arr == ARRAY(sorted));
+
+    Array<i32> s = slice(arr, 1, 3);
+    ASSERT(s.count == 2 && s[0] == 2 && s[1] == 3);
+    ASSERT(array_find_index(arr, 4) == 3);
+
+    array_remove(&arr, 0);
+    ASSERT(arr.count == 4 && arr[0] == 2);
+}
+
+TEST_PROC(soa_array__fields_are_contiguous_and_aligned)
+{
+    SoaArray<f32, u8, u64> arr{};
+    defer { array_reset(&arr); };
+
+    for (i32 i = 0; i < 100; i++) array_add(&arr, i*0.5f, i % 256, i*1000);
+    ASSERT(arr.count == 100);
+
+    Array<f32> xs = soa_field<0>(&arr);
+    Array<u8> flags = soa_field<1>(&arr);
+    Array<u64> ids = soa_field<2>(&arr);
+
+    for (i32 i = 0; i < arr.field_count; i++) {
+        ASSERT(((u64)arr.fields[i] & (SOA_ARRAY_FIELD_ALIGN-1)) == 0);
+    }
+
+    for (i32 i = 0; i < 100; i++) {
+        ASSERT(xs[i] == i*0.5f);
+        ASSERT(flags[i] == i);
+        ASSERT(ids[i] == (u64)i*1000);
+    }
+
+    soa_set(&arr, 3, -1.0f, 7, 9);
+    ASSERT(xs[3] == -1.0f && flags[3] == 7 && ids[3] == 9);
+}
+
+TEST_PROC(soa_array__remove_keeps_fields_in_step)
+{
+    SoaArray<i32, i64> arr{};
+    defer { array_reset(&arr); };
+
+    for (i32 i = 0; i < 10; i++) array_add(&arr, i, -i);
+
+    array_remove(&arr, 2);
+    ASSERT(arr.count == 9);
+    ASSERT(soa_field<0>(&arr)[2] == 3 && soa_field<1>(&arr)[2] == -3);
+
+    array_remove_unsorted(&arr, 0);
+    ASSERT(arr.count == 8);
+    ASSERT(soa_field<0>(&arr)[0] == 9 && soa_field<1>(&arr)[0] == -9);
+
+    for (i32 i = 0; i < arr.count; i++) ASSERT(soa_field<0>(&arr)[i] == -soa_field<1>(&arr)[i]);
+}
+
+TEST_PROC(soa_array__sort_by_field_moves_every_field)
+{
+    SoaArray<i32, f32, u16> arr{};
+    defer { array_reset(&arr); };
+
+    for (i32 i = 0; i < 200; i++) {
+        i32 key = (i*7919) % 200;
+        array_add(&arr, i, (f32)key, key);
+    }
+
+    soa_sort<1>(&arr);
+    for (i32 i = 0; i < arr.count; i++) {
+        ASSERT(soa_field<1>(&arr)[i] == (f32)i);
+        ASSERT(soa_field<2>(&arr)[i] == i);
+        ASSERT((soa_field<0>(&arr)[i]*7919) % 200 == i);
+    }
+
+    soa_sort<0>(&arr, [](i32 &a, i32 &b) { return a > b; });
+    for (i32 i = 0; i < arr.count; i++) ASSERT(soa_field<0>(&arr)[i] == 199-i);
+}
+
 TEST_PROC(array__pop)
 {
     {
@@ -631,6 +860,99 @@ TEST_PROC(array__find)
     }
 }
 
+TEST_PROC(array__simd_find_and_count_match_scalar)
+{
+    i32 ints[67];
+    u64 wide[67];
+    void *ptrs[67];
+
+    for (i32 count = 0; count <= ARRAY_COUNT(ints); count++) {
+        for (i32 i = 0; i < count; i++) {
+            ints[i] = -(i % 5);
+            wide[i] = (u64)(i % 7) << 32 | (u64)(i % 3);
+            ptrs[i] = &ints[i % 4];
+        }
+
+        Array<i32> a{ ints, count };
+        Array<u64> b{ wide, count };
+        Array<void*> c{ ptrs, count };
+
+        for (i32 needle = -5; needle <= 0; needle++) {
+            i32 first = -1, matches = 0;
+            for (i32 i = 0; i < count; i++) {
+                if (ints[i] != needle) continue;
+                if (first == -1) first = i;
+                matches++;
+            }
+
+            ASSERT(array_find_index(a, needle) == first);
+            ASSERT(array_count(a, needle) == matches);
+
+#if ARRAY_SIMD
+            ASSERT(array_find_index32_sse2((u32*)ints, count, (u32)needle) == first);
+            ASSERT(array_count32_sse2((u32*)ints, count, (u32)needle) == matches);
+#endif
+        }
+
+        // NOTE(jesper): only the low halves match, which the SSE2 64-bit
+        // compare must not report as a hit
+        u64 needle = (u64)6 << 32 | 1;
+        i32 first = -1, matches = 0;
+        for (i32 i = 0; i < count; i++) {
+            if (wide[i] != needle) continue;
+            if (first == -1) first = i;
+            matches++;
+        }
+
+        ASSERT(array_find_index(b, needle) == first);
+        ASSERT(array_count(b, needle) == matches);
+        ASSERT(array_find_index(b, (u64)1) == (count > 7 ? 7 : -1));
+
+#if ARRAY_SIMD
+        ASSERT(array_find_index64_sse2(wide, count, needle) == first);
+        ASSERT(array_count64_sse2(wide, count, needle) == matches);
+        ASSERT(array_find_index64_sse2(wide, count, 1) == (count > 7 ? 7 : -1));
+#endif
+
+        ASSERT(array_find_index(c, (void*)&ints[3]) == (count > 3 ? 3 : -1));
+        ASSERT(array_count(c, (void*)&ints[0]) == (count+3)/4);
+    }
+}
+
+TEST_PROC(array__simd_min_max_match_scalar)
+{
+    i32 ints[45];
+    u32 uints[45];
+    for (i32 i = 0; i < ARRAY_COUNT(ints); i++) {
+        ints[i] = (i*7919 % 101) - 50;
+        uints[i] = 0x80000000u + (u32)(i*7919 % 101);
+    }
+
+    for (i32 count = 1; count <= ARRAY_COUNT(ints); count++) {
+        i32 imax = ints[0], imin = ints[0];
+        u32 umax = uints[0], umin = uints[0];
+        for (i32 i = 1; i < count; i++) {
+            imax = MAX(imax, ints[i]); imin = MIN(imin, ints[i]);
+            umax = MAX(umax, uints[i]); umin = MIN(umin, uints[i]);
+        }
+
+        ASSERT(array_max(ints[0], Array<i32>{ ints, count }) == imax);
+        ASSERT(array_min(ints[0], Array<i32>{ ints, count }) == imin);
+        ASSERT(array_max(uints[0], Array<u32>{ uints, count }) == umax);
+        ASSERT(array_min(uints[0], Array<u32>{ uints, count }) == umin);
+
+#if ARRAY_SIMD
+        if (array_simd_level() >= ARRAY_SIMD_SSE41) {
+            ASSERT((array_reduce32_sse41<i32, true>(ints, count)) == imax);
+            ASSERT((array_reduce32_sse41<u32, false>(uints, count)) == umin);
+        }
+#endif
+    }
+
+    ASSERT(array_max(1000, Array<i32>{ ints, 8 }) == 1000);
+    ASSERT(array_min(7, Array<i32>{}) == 7);
+}
+
 TEST_PROC(array__swap)
 {
     // Test single array swap
@@ -704,6 +1026,75 @@ TEST_PROC(array__sort)
     }
 }
 
+TEST_PROC(array__sort_handles_adversarial_input)
+{
+    const i32 count = 100000;
+    i32 *keys = ALLOC_ARR(mem_dynamic, i32, count);
+    i32 *values = ALLOC_ARR(mem_dynamic, i32, count);
+    defer { FREE(mem_dynamic, keys); FREE(mem_dynamic, values); };
+
+    for (i32 pattern = 0; pattern < 4; pattern++) {
+        for (i32 i = 0; i < count; i++) {
+            switch (pattern) {
+            case 0: keys[i] = i; break;
+            case 1: keys[i] = count-i; break;
+            case 2: keys[i] = 7; break;
+            case 3: keys[i] = i < count/2 ? i : count-i; break;
+            }
+            values[i] = keys[i]*3;
+        }
+
+        Array<i32> key_arr{ keys, count };
+        Array<i32> value_arr{ values, count };
+        quick_sort(key_arr, [](i32 &a, i32 &b) { return a < b; }, value_arr);
+
+        for (i32 i = 0; i < count-1; i++) ASSERT(keys[i] <= keys[i+1]);
+        for (i32 i = 0; i < count; i++) ASSERT(values[i] == keys[i]*3);
+    }
+}
+
+TEST_PROC(array__radix_sort_orders_integers_and_floats)
+{
+    i32 ints[] = { 5, -3, 1000000, 0, -2000000000, 42, 1, -1 };
+    radix_sort(ARRAY(ints));
+    for (i32 i = 0; i < ARRAY_COUNT(ints)-1; i++) ASSERT(ints[i] <= ints[i+1]);
+
+    f32 floats[] = { 1.5f, -0.5f, 0.0f, -100.0f, 3.25f, -0.25f, 1e9f };
+    radix_sort(ARRAY(floats));
+    for (i32 i = 0; i < ARRAY_COUNT(floats)-1; i++) ASSERT(floats[i] <= floats[i+1]);
+
+    struct DrawKey { u64 key; i32 index; };
+    DrawKey draws[] = { { 3, 0 }, { 1ull << 40, 1 }, { 3, 2 }, { 0, 3 }, { 1, 4 }, { 3, 5 } };
+    radix_sort(ARRAY(draws), [](const DrawKey &it) { return it.key; });
+
+    i32 expected[] = { 3, 4, 0, 2, 5, 1 };
+    for (i32 i = 0; i < ARRAY_COUNT(draws); i++) ASSERT(draws[i].index == expected[i]);
+}
+
+TEST_PROC(array__parallel_sort_matches_sorted_order)
+{
+    const i32 count = 300000;
+    u32 *data = ALLOC_ARR(mem_dynamic, u32, count);
+    defer { FREE(mem_dynamic, data); };
+
+    u32 seed = 1;
+    u64 sum = 0;
+    for (i32 i = 0; i < count; i++) {
+        seed = seed*1664525u + 1013904223u;
+        data[i] = seed >> 8;
+        sum += data[i];
+    }
+
+    parallel_sort(Array<u32>{ data, count }, [](u32 &a, u32 &b) { return a < b; }, 4);
+
+    u64 sorted_sum = data[count-1];
+    for (i32 i = 0; i < count-1; i++) {
+        ASSERT(data[i] <= data[i+1]);
+        sorted_sum += data[i];
+    }
+    ASSERT(sorted_sum == sum);
+}
+
 TEST_PROC(array__default_sort_is_ascending)
 {
     int data[] = {5, 3, 1, 4, 2};
@@ -1,4 +1,11 @@
-
 #ifdef MAP_GENERATED_IMPL
 #define MAP_INTERNAL
 #endif
+
+#if defined(MAP_INTERNAL) && !defined(MAP_INTERNAL_ONCE)
+#define MAP_INTERNAL_ONCE
+
+static i32 concurrent_map_thread_proc(void *user_data);
+static i32 concurrent_map_reader_proc(void *user_data);
+
+#endif
@@ -10,5 +10,11 @@ static bool is_aligned(void *ptr, u8 alignment);
 static bool is_overlapping(void *a, i64 a_size, void *b, i64 b_size);
 static i64 vm_freelist_exact_page_request_size(VMFreeListState *state, u8 alignment);
 static i64 vm_freelist_near_exact_page_request_size(VMFreeListState *state, u8 alignment);
+static VMFreeListState::Header *vm_freelist_header(void *ptr);
+static i32 linear_alloc_thread_proc(void *user_data);
+static i32 tl_cache_alloc_thread_proc(void *user_data);
+static i32 tl_cache_free_thread_proc(void *user_data);
+static AllocatorSnapshot *find_allocator_snapshot(AllocatorSnapshot *snapshots, i32 count, const char *name);
+static i32 scratch_thread_proc(void *user_data);
 
 #endif
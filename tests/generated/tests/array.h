@@ -8,6 +8,11 @@ extern void dynamic_array__append();
 extern void dynamic_array__insert();
 extern void dynamic_array__set();
 extern void dynamic_array__reserve();
+extern void dynamic_array__grow_past_large_alloc_preserves_contents();
+extern void dynamic_array__grow_moves_non_trivial_elements();
+extern void dynamic_array__emplace_constructs_in_place();
+extern void dynamic_array__insert_shifts_by_move();
+extern void dynamic_array__insert_many_keeps_order();
 extern void dynamic_array__resize();
 extern void fixed_array__basic_construction();
 extern void fixed_array__copy_operations();
@@ -15,14 +20,26 @@ extern void fixed_array__copy_invokes_copy_constructor_for_each_element();
 extern void fixed_array__self_assign_avoids_copies();
 extern void fixed_array__size_limits();
 extern void fixed_array__data_pointer_integrity();
+extern void small_array__stays_inline_until_full();
+extern void small_array__copy_and_move_keep_own_storage();
+extern void small_array__copy_assign_destroys_old_elements();
+extern void small_array__interops_with_array_procedures();
+extern void soa_array__fields_are_contiguous_and_aligned();
+extern void soa_array__remove_keeps_fields_in_step();
+extern void soa_array__sort_by_field_moves_every_field();
 extern void array__pop();
 extern void array__tail();
 extern void array__create();
 extern void array__remove();
 extern void array__slice();
 extern void array__find();
+extern void array__simd_find_and_count_match_scalar();
+extern void array__simd_min_max_match_scalar();
 extern void array__swap();
 extern void array__sort();
+extern void array__sort_handles_adversarial_input();
+extern void array__radix_sort_orders_integers_and_floats();
+extern void array__parallel_sort_matches_sorted_order();
 extern void array__default_sort_is_ascending();
 extern void array__sort_comparator_ascending();
 extern void array__sort_comparator_descending();
@@ -36,8 +53,13 @@ TestSuite ARRAY__array__tests[] = {
 	{ "remove", array__remove },
 	{ "slice", array__slice },
 	{ "find", array__find },
+	{ "simd_find_and_count_match_scalar", array__simd_find_and_count_match_scalar },
+	{ "simd_min_max_match_scalar", array__simd_min_max_match_scalar },
 	{ "swap", array__swap },
 	{ "sort", array__sort },
+	{ "sort_handles_adversarial_input", array__sort_handles_adversarial_input },
+	{ "radix_sort_orders_integers_and_floats", array__radix_sort_orders_integers_and_floats },
+	{ "parallel_sort_matches_sorted_order", array__parallel_sort_matches_sorted_order },
 	{ "default_sort_is_ascending", array__default_sort_is_ascending },
 	{ "sort_comparator_ascending", array__sort_comparator_ascending },
 	{ "sort_comparator_descending", array__sort_comparator_descending },
@@ -49,6 +71,11 @@ TestSuite ARRAY__dynamic_array__tests[] = {
 	{ "insert", dynamic_array__insert },
 	{ "set", dynamic_array__set },
 	{ "reserve", dynamic_array__reserve },
+	{ "grow_past_large_alloc_preserves_contents", dynamic_array__grow_past_large_alloc_preserves_contents },
+	{ "grow_moves_non_trivial_elements", dynamic_array__grow_moves_non_trivial_elements },
+	{ "emplace_constructs_in_place", dynamic_array__emplace_constructs_in_place },
+	{ "insert_shifts_by_move", dynamic_array__insert_shifts_by_move },
+	{ "insert_many_keeps_order", dynamic_array__insert_many_keeps_order },
 	{ "resize", dynamic_array__resize },
 };
 
@@ -61,10 +88,25 @@ TestSuite ARRAY__fixed_array__tests[] = {
 	{ "data_pointer_integrity", fixed_array__data_pointer_integrity },
 };
 
+TestSuite ARRAY__small_array__tests[] = {
+	{ "stays_inline_until_full", small_array__stays_inline_until_full },
+	{ "copy_and_move_keep_own_storage", small_array__copy_and_move_keep_own_storage },
+	{ "copy_assign_destroys_old_elements", small_array__copy_assign_destroys_old_elements },
+	{ "interops_with_array_procedures", small_array__interops_with_array_procedures },
+};
+
+TestSuite ARRAY__soa_array__tests[] = {
+	{ "fields_are_contiguous_and_aligned", soa_array__fields_are_contiguous_and_aligned },
+	{ "remove_keeps_fields_in_step", soa_array__remove_keeps_fields_in_step },
+	{ "sort_by_field_moves_every_field", soa_array__sort_by_field_moves_every_field },
+};
+
 TestSuite ARRAY__tests[] = {
 	{ "array", nullptr, ARRAY__array__tests, sizeof(ARRAY__array__tests)/sizeof(ARRAY__array__tests[0]) },
 	{ "dynamic_array", nullptr, ARRAY__dynamic_array__tests, sizeof(ARRAY__dynamic_array__tests)/sizeof(ARRAY__dynamic_array__tests[0]) },
 	{ "fixed_array", nullptr, ARRAY__fixed_array__tests, sizeof(ARRAY__fixed_array__tests)/sizeof(ARRAY__fixed_array__tests[0]) },
+	{ "small_array", nullptr, ARRAY__small_array__tests, sizeof(ARRAY__small_array__tests)/sizeof(ARRAY__small_array__tests[0]) },
+	{ "soa_array", nullptr, ARRAY__soa_array__tests, sizeof(ARRAY__soa_array__tests)/sizeof(ARRAY__soa_array__tests[0]) },
 };
 
 #endif // ARRAY_TEST_H
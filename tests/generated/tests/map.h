@@ -2,17 +2,77 @@
 #define MAP_TEST_H
 
 extern void dynamic_map__set_invokes_copy_constructor_for_key_and_value();
-extern void dynamic_map__growing_map_invokes_copy_constructors();
+extern void dynamic_map__growing_map_invokes_move_constructors();
 extern void dynamic_map__set_of_existing_key_invokes_copy_assign_for_value_and_nothing_for_key();
+extern void dynamic_map__remove_keeps_colliding_keys_reachable();
+extern void dynamic_map__churn_does_not_grow_capacity();
+extern void dynamic_map__compact_shrinks_and_keeps_entries();
+extern void dynamic_map__capacity_is_power_of_two_within_load_factor();
+extern void dynamic_map__probe_distances_stay_ordered_under_churn();
+extern void dynamic_map__string_keys_survive_growth();
+extern void dynamic_map__small_array_values_survive_rehash();
+extern void dynamic_map__remove_releases_small_array_values();
+extern void swiss_map__set_then_find_returns_value();
+extern void swiss_map__set_of_existing_key_replaces_value();
+extern void swiss_map__capacity_is_power_of_two_within_load_factor();
+extern void swiss_map__remove_keeps_other_keys_reachable();
+extern void swiss_map__churn_does_not_grow_capacity();
+extern void swiss_map__find_emplace_inserts_default_once();
+extern void swiss_map__string_keys();
+extern void swiss_map__keys_with_only_inequality();
+extern void swiss_map__iterates_every_pair_once();
+extern void sorted_map__iterates_in_key_order();
+extern void sorted_map__range_is_half_open();
+extern void sorted_map__set_batch_merges_and_last_duplicate_wins();
+extern void sorted_map__string_keys();
+extern void concurrent_map__set_and_find();
+extern void concurrent_map__concurrent_inserts_agree();
+extern void concurrent_map__writer_progresses_under_constant_reads();
 
 TestSuite MAP__dynamic_map__tests[] = {
 	{ "set_invokes_copy_constructor_for_key_and_value", dynamic_map__set_invokes_copy_constructor_for_key_and_value },
-	{ "growing_map_invokes_copy_constructors", dynamic_map__growing_map_invokes_copy_constructors },
+	{ "growing_map_invokes_move_constructors", dynamic_map__growing_map_invokes_move_constructors },
 	{ "set_of_existing_key_invokes_copy_assign_for_value_and_nothing_for_key", dynamic_map__set_of_existing_key_invokes_copy_assign_for_value_and_nothing_for_key },
+	{ "remove_keeps_colliding_keys_reachable", dynamic_map__remove_keeps_colliding_keys_reachable },
+	{ "churn_does_not_grow_capacity", dynamic_map__churn_does_not_grow_capacity },
+	{ "compact_shrinks_and_keeps_entries", dynamic_map__compact_shrinks_and_keeps_entries },
+	{ "capacity_is_power_of_two_within_load_factor", dynamic_map__capacity_is_power_of_two_within_load_factor },
+	{ "probe_distances_stay_ordered_under_churn", dynamic_map__probe_distances_stay_ordered_under_churn },
+	{ "string_keys_survive_growth", dynamic_map__string_keys_survive_growth },
+	{ "small_array_values_survive_rehash", dynamic_map__small_array_values_survive_rehash },
+	{ "remove_releases_small_array_values", dynamic_map__remove_releases_small_array_values },
+};
+
+TestSuite MAP__swiss_map__tests[] = {
+	{ "set_then_find_returns_value", swiss_map__set_then_find_returns_value },
+	{ "set_of_existing_key_replaces_value", swiss_map__set_of_existing_key_replaces_value },
+	{ "capacity_is_power_of_two_within_load_factor", swiss_map__capacity_is_power_of_two_within_load_factor },
+	{ "remove_keeps_other_keys_reachable", swiss_map__remove_keeps_other_keys_reachable },
+	{ "churn_does_not_grow_capacity", swiss_map__churn_does_not_grow_capacity },
+	{ "find_emplace_inserts_default_once", swiss_map__find_emplace_inserts_default_once },
+	{ "string_keys", swiss_map__string_keys },
+	{ "keys_with_only_inequality", swiss_map__keys_with_only_inequality },
+	{ "iterates_every_pair_once", swiss_map__iterates_every_pair_once },
+};
+
+TestSuite MAP__sorted_map__tests[] = {
+	{ "iterates_in_key_order", sorted_map__iterates_in_key_order },
+	{ "range_is_half_open", sorted_map__range_is_half_open },
+	{ "set_batch_merges_and_last_duplicate_wins", sorted_map__set_batch_merges_and_last_duplicate_wins },
+	{ "string_keys", sorted_map__string_keys },
+};
+
+TestSuite MAP__concurrent_map__tests[] = {
+	{ "set_and_find", concurrent_map__set_and_find },
+	{ "concurrent_inserts_agree", concurrent_map__concurrent_inserts_agree },
+	{ "writer_progresses_under_constant_reads", concurrent_map__writer_progresses_under_constant_reads },
 };
 
 TestSuite MAP__tests[] = {
+	{ "concurrent_map", nullptr, MAP__concurrent_map__tests, sizeof(MAP__concurrent_map__tests)/sizeof(MAP__concurrent_map__tests[0]) },
 	{ "dynamic_map", nullptr, MAP__dynamic_map__tests, sizeof(MAP__dynamic_map__tests)/sizeof(MAP__dynamic_map__tests[0]) },
+	{ "sorted_map", nullptr, MAP__sorted_map__tests, sizeof(MAP__sorted_map__tests)/sizeof(MAP__sorted_map__tests[0]) },
+	{ "swiss_map", nullptr, MAP__swiss_map__tests, sizeof(MAP__swiss_map__tests)/sizeof(MAP__swiss_map__tests[0]) },
 };
 
 #endif // MAP_TEST_H
@@ -16,7 +16,32 @@ extern void memory__tl_linear__extend_non_last_alloc_does_not_copy_data();
 extern void memory__tl_linear__reset_to_start();
 extern void memory__tl_linear__reset_to_restore_point();
 extern void memory__tl_linear__alloc_beyond_capacity_panics();
+extern void memory__tl_linear__alloc_commits_pages_on_demand();
+extern void memory__tl_linear__realloc_inplace_commits_pages();
+extern void memory__tl_linear__reset_decommits_and_recommits();
+extern void memory__tl_linear__restore_point_reset_keeps_committed();
+extern void memory__tl_linear__reset_poisons_released_memory();
+extern void memory__tl_linear__reset_detects_overrun();
+extern void memory__tl_linear__realloc_inplace_moves_redzone();
+extern void memory__tl_linear__numa_local_is_reported_and_usable();
+extern void memory__tl_linear__default_flags_report_no_numa_node();
 extern void memory__tl_linear__get_allocator_info_reports_usage();
+extern void memory__tl_block__alloc_beyond_block_size_chains_new_block();
+extern void memory__tl_block__restore_point_across_blocks();
+extern void memory__tl_block__reset_recycles_block();
+extern void memory__tl_block__realloc_last_alloc_is_inplace();
+extern void memory__tl_block__arena_grows_past_initial_size();
+extern void memory__arena_pool__release_then_acquire_reuses_arena();
+extern void memory__arena_pool__size_classes_are_kept_apart();
+extern void memory__arena_pool__released_arena_drops_extra_blocks();
+extern void memory__linear__reset_decommits_and_recommits();
+extern void memory__linear__extend_last_alloc_is_inplace();
+extern void memory__linear__zero_size_alloc_ends_inplace_extend();
+extern void memory__linear__concurrent_allocs_dont_overlap();
+extern void memory__linear__reset_detects_overrun();
+extern void memory__linear__huge_pages_are_reported_and_usable();
+extern void memory__linear__explicit_huge_pages_fall_back();
+extern void memory__linear__default_flags_report_no_huge_pages();
 extern void memory__linear__get_allocator_info_reports_usage();
 extern void memory__malloc__alloc_returns_nonnull();
 extern void memory__malloc__alloc_zero_size_returns_nonnull();
@@ -26,18 +51,51 @@ extern void memory__malloc__realloc_preserves_data();
 extern void memory__malloc__realloc_null_ptr_acts_as_alloc();
 extern void memory__malloc__extend_is_fresh_alloc_no_copy();
 extern void memory__malloc__reset_logs_error_and_returns_null();
-extern void memory__malloc__get_allocator_info_reports_zero_usage();
-extern void memory__malloc__get_allocator_info_stays_zero_after_allocations();
+extern void memory__malloc__large_alloc_respects_alignment();
+extern void memory__malloc__realloc_into_large_preserves_data();
+extern void memory__malloc__extend_large_preserves_data_when_inplace();
+extern void memory__malloc__get_allocator_info_reports_no_capacity();
+extern void memory__malloc__get_allocator_info_tracks_alloc_and_free();
 extern void memory__vm_freelist__get_allocator_info_reports_capacity();
 extern void memory__vm_freelist__get_allocator_info_tracks_alloc_and_free();
 extern void memory__vm_freelist__near_exact_initial_alloc_succeeds();
 extern void memory__vm_freelist__free_then_exact_fit_reuses_committed_page();
 extern void memory__vm_freelist__free_then_near_exact_fit_reuses_committed_page();
 extern void memory__vm_freelist__alternating_near_page_sizes_do_not_grow_committed();
+extern void memory__vm_freelist__huge_pages_are_reported_and_usable();
+extern void memory__tl_cache__alloc_returns_aligned_nonnull();
+extern void memory__tl_cache__free_then_alloc_same_class_reuses_block();
+extern void memory__tl_cache__refill_takes_a_batch_from_backing();
+extern void memory__tl_cache__full_magazine_flushes_to_backing();
+extern void memory__tl_cache__large_and_overaligned_allocs_bypass_cache();
+extern void memory__tl_cache__realloc_within_class_is_inplace();
+extern void memory__tl_cache__realloc_across_classes_preserves_data();
+extern void memory__tl_cache__free_on_another_thread_flushes_to_backing_on_exit();
+extern void memory__slab__alloc_is_aligned_to_size_class();
+extern void memory__slab__free_then_alloc_reuses_slot();
+extern void memory__slab__info_reports_per_class_usage();
+extern void memory__slab__full_slab_spills_into_new_slab();
+extern void memory__slab__large_alloc_run_is_recycled();
+extern void memory__slab__realloc_preserves_data();
+extern void memory__slab__alloc_beyond_reserve_fails();
+extern void memory__tracking__info_reports_live_and_peak_bytes();
+extern void memory__tracking__attributes_allocations_to_callsites();
+extern void memory__tracking__untracked_allocations_share_an_entry();
+extern void memory__tracking__realloc_preserves_data_and_alignment();
+extern void memory__tracking__out_of_place_extend_keeps_old_allocation_live();
+extern void memory__telemetry__constructors_register_allocators();
+extern void memory__telemetry__snapshots_respect_max_count();
+extern void memory__telemetry__tl_linear_peak_survives_reset();
+extern void memory__telemetry__tl_arena_reports_chain_usage();
+extern void memory__telemetry__vm_freelist_reports_fragmentation();
+extern void memory__telemetry__slab_reports_peak_commit_and_fragmentation();
 extern void memory__scratch__alloc_returns_usable_memory();
 extern void memory__scratch__release_restores_to_restore_point();
 extern void memory__scratch__no_conflict_reuses_same_underlying_arena();
 extern void memory__scratch__conflict_returns_different_arena();
+extern void memory__scratch__multiple_conflicts_pick_lowest_free_arena();
+extern void memory__scratch__deep_conflict_chain_cycles_lowest_arenas();
+extern void memory__scratch__all_arenas_in_conflict_panics();
 extern void memory__scratch__non_scratch_conflict_still_returns_arena();
 extern void memory__scratch__nested_caller_callee_use_different_arenas();
 extern void memory__scratch__nested_inner_release_does_not_corrupt_outer();
@@ -48,6 +106,7 @@ extern void memory__scratch__sarena_raii_restores_on_scope_exit();
 extern void memory__scratch__alloc_before_and_after_inner_scope_both_survive();
 extern void memory__scratch__sarena_nested_scopes_lifo_ordering();
 extern void memory__scratch__multiple_allocs_accumulate_before_release();
+extern void memory__scratch__concurrent_threads_use_isolated_arenas();
 extern void memory__arena__restore_resets_to_creation_point();
 extern void memory__arena__get_info_size_is_constant();
 extern void memory__arena__get_info_used_tracks_allocations();
@@ -58,6 +117,11 @@ extern void memory__buffer__read_beyond_end_panics();
 extern void memory__buffer__write_beyond_end_panics();
 extern void memory__buffer__typed_read_beyond_end_panics();
 extern void memory__buffer__typed_write_beyond_end_panics();
+extern void memory__pool__add_and_get();
+extern void memory__pool__freed_handle_is_stale();
+extern void memory__pool__growth_keeps_addresses_stable();
+extern void memory__pool__invalid_handles_return_null();
+extern void memory__pool__free_and_destroy_run_destructors();
 extern void memory__macros__alloc_t_constructs_typed_object();
 extern void memory__macros__alloc_arr_allocates_typed_array();
 extern void memory__macros__realloc_arr_preserves_existing_data();
@@ -82,10 +146,41 @@ TestSuite MEMORY__memory__tl_linear__tests[] = {
 	{ "reset_to_start", memory__tl_linear__reset_to_start },
 	{ "reset_to_restore_point", memory__tl_linear__reset_to_restore_point },
 	{ "alloc_beyond_capacity_panics", memory__tl_linear__alloc_beyond_capacity_panics },
+	{ "alloc_commits_pages_on_demand", memory__tl_linear__alloc_commits_pages_on_demand },
+	{ "realloc_inplace_commits_pages", memory__tl_linear__realloc_inplace_commits_pages },
+	{ "reset_decommits_and_recommits", memory__tl_linear__reset_decommits_and_recommits },
+	{ "restore_point_reset_keeps_committed", memory__tl_linear__restore_point_reset_keeps_committed },
+	{ "reset_poisons_released_memory", memory__tl_linear__reset_poisons_released_memory },
+	{ "reset_detects_overrun", memory__tl_linear__reset_detects_overrun },
+	{ "realloc_inplace_moves_redzone", memory__tl_linear__realloc_inplace_moves_redzone },
+	{ "numa_local_is_reported_and_usable", memory__tl_linear__numa_local_is_reported_and_usable },
+	{ "default_flags_report_no_numa_node", memory__tl_linear__default_flags_report_no_numa_node },
 	{ "get_allocator_info_reports_usage", memory__tl_linear__get_allocator_info_reports_usage },
 };
 
+TestSuite MEMORY__memory__tl_block__tests[] = {
+	{ "alloc_beyond_block_size_chains_new_block", memory__tl_block__alloc_beyond_block_size_chains_new_block },
+	{ "restore_point_across_blocks", memory__tl_block__restore_point_across_blocks },
+	{ "reset_recycles_block", memory__tl_block__reset_recycles_block },
+	{ "realloc_last_alloc_is_inplace", memory__tl_block__realloc_last_alloc_is_inplace },
+	{ "arena_grows_past_initial_size", memory__tl_block__arena_grows_past_initial_size },
+};
+
+TestSuite MEMORY__memory__arena_pool__tests[] = {
+	{ "release_then_acquire_reuses_arena", memory__arena_pool__release_then_acquire_reuses_arena },
+	{ "size_classes_are_kept_apart", memory__arena_pool__size_classes_are_kept_apart },
+	{ "released_arena_drops_extra_blocks", memory__arena_pool__released_arena_drops_extra_blocks },
+};
+
 TestSuite MEMORY__memory__linear__tests[] = {
+	{ "reset_decommits_and_recommits", memory__linear__reset_decommits_and_recommits },
+	{ "extend_last_alloc_is_inplace", memory__linear__extend_last_alloc_is_inplace },
+	{ "zero_size_alloc_ends_inplace_extend", memory__linear__zero_size_alloc_ends_inplace_extend },
+	{ "concurrent_allocs_dont_overlap", memory__linear__concurrent_allocs_dont_overlap },
+	{ "reset_detects_overrun", memory__linear__reset_detects_overrun },
+	{ "huge_pages_are_reported_and_usable", memory__linear__huge_pages_are_reported_and_usable },
+	{ "explicit_huge_pages_fall_back", memory__linear__explicit_huge_pages_fall_back },
+	{ "default_flags_report_no_huge_pages", memory__linear__default_flags_report_no_huge_pages },
 	{ "get_allocator_info_reports_usage", memory__linear__get_allocator_info_reports_usage },
 };
 
@@ -98,8 +193,11 @@ TestSuite MEMORY__memory__malloc__tests[] = {
 	{ "realloc_null_ptr_acts_as_alloc", memory__malloc__realloc_null_ptr_acts_as_alloc },
 	{ "extend_is_fresh_alloc_no_copy", memory__malloc__extend_is_fresh_alloc_no_copy },
 	{ "reset_logs_error_and_returns_null", memory__malloc__reset_logs_error_and_returns_null },
-	{ "get_allocator_info_reports_zero_usage", memory__malloc__get_allocator_info_reports_zero_usage },
-	{ "get_allocator_info_stays_zero_after_allocations", memory__malloc__get_allocator_info_stays_zero_after_allocations },
+	{ "large_alloc_respects_alignment", memory__malloc__large_alloc_respects_alignment },
+	{ "realloc_into_large_preserves_data", memory__malloc__realloc_into_large_preserves_data },
+	{ "extend_large_preserves_data_when_inplace", memory__malloc__extend_large_preserves_data_when_inplace },
+	{ "get_allocator_info_reports_no_capacity", memory__malloc__get_allocator_info_reports_no_capacity },
+	{ "get_allocator_info_tracks_alloc_and_free", memory__malloc__get_allocator_info_tracks_alloc_and_free },
 };
 
 TestSuite MEMORY__memory__vm_freelist__tests[] = {
@@ -109,6 +207,45 @@ TestSuite MEMORY__memory__vm_freelist__tests[] = {
 	{ "free_then_exact_fit_reuses_committed_page", memory__vm_freelist__free_then_exact_fit_reuses_committed_page },
 	{ "free_then_near_exact_fit_reuses_committed_page", memory__vm_freelist__free_then_near_exact_fit_reuses_committed_page },
 	{ "alternating_near_page_sizes_do_not_grow_committed", memory__vm_freelist__alternating_near_page_sizes_do_not_grow_committed },
+	{ "huge_pages_are_reported_and_usable", memory__vm_freelist__huge_pages_are_reported_and_usable },
+};
+
+TestSuite MEMORY__memory__tl_cache__tests[] = {
+	{ "alloc_returns_aligned_nonnull", memory__tl_cache__alloc_returns_aligned_nonnull },
+	{ "free_then_alloc_same_class_reuses_block", memory__tl_cache__free_then_alloc_same_class_reuses_block },
+	{ "refill_takes_a_batch_from_backing", memory__tl_cache__refill_takes_a_batch_from_backing },
+	{ "full_magazine_flushes_to_backing", memory__tl_cache__full_magazine_flushes_to_backing },
+	{ "large_and_overaligned_allocs_bypass_cache", memory__tl_cache__large_and_overaligned_allocs_bypass_cache },
+	{ "realloc_within_class_is_inplace", memory__tl_cache__realloc_within_class_is_inplace },
+	{ "realloc_across_classes_preserves_data", memory__tl_cache__realloc_across_classes_preserves_data },
+	{ "free_on_another_thread_flushes_to_backing_on_exit", memory__tl_cache__free_on_another_thread_flushes_to_backing_on_exit },
+};
+
+TestSuite MEMORY__memory__slab__tests[] = {
+	{ "alloc_is_aligned_to_size_class", memory__slab__alloc_is_aligned_to_size_class },
+	{ "free_then_alloc_reuses_slot", memory__slab__free_then_alloc_reuses_slot },
+	{ "info_reports_per_class_usage", memory__slab__info_reports_per_class_usage },
+	{ "full_slab_spills_into_new_slab", memory__slab__full_slab_spills_into_new_slab },
+	{ "large_alloc_run_is_recycled", memory__slab__large_alloc_run_is_recycled },
+	{ "realloc_preserves_data", memory__slab__realloc_preserves_data },
+	{ "alloc_beyond_reserve_fails", memory__slab__alloc_beyond_reserve_fails },
+};
+
+TestSuite MEMORY__memory__tracking__tests[] = {
+	{ "info_reports_live_and_peak_bytes", memory__tracking__info_reports_live_and_peak_bytes },
+	{ "attributes_allocations_to_callsites", memory__tracking__attributes_allocations_to_callsites },
+	{ "untracked_allocations_share_an_entry", memory__tracking__untracked_allocations_share_an_entry },
+	{ "realloc_preserves_data_and_alignment", memory__tracking__realloc_preserves_data_and_alignment },
+	{ "out_of_place_extend_keeps_old_allocation_live", memory__tracking__out_of_place_extend_keeps_old_allocation_live },
+};
+
+TestSuite MEMORY__memory__telemetry__tests[] = {
+	{ "constructors_register_allocators", memory__telemetry__constructors_register_allocators },
+	{ "snapshots_respect_max_count", memory__telemetry__snapshots_respect_max_count },
+	{ "tl_linear_peak_survives_reset", memory__telemetry__tl_linear_peak_survives_reset },
+	{ "tl_arena_reports_chain_usage", memory__telemetry__tl_arena_reports_chain_usage },
+	{ "vm_freelist_reports_fragmentation", memory__telemetry__vm_freelist_reports_fragmentation },
+	{ "slab_reports_peak_commit_and_fragmentation", memory__telemetry__slab_reports_peak_commit_and_fragmentation },
 };
 
 TestSuite MEMORY__memory__scratch__tests[] = {
@@ -116,6 +253,9 @@ TestSuite MEMORY__memory__scratch__tests[] = {
 	{ "release_restores_to_restore_point", memory__scratch__release_restores_to_restore_point },
 	{ "no_conflict_reuses_same_underlying_arena", memory__scratch__no_conflict_reuses_same_underlying_arena },
 	{ "conflict_returns_different_arena", memory__scratch__conflict_returns_different_arena },
+	{ "multiple_conflicts_pick_lowest_free_arena", memory__scratch__multiple_conflicts_pick_lowest_free_arena },
+	{ "deep_conflict_chain_cycles_lowest_arenas", memory__scratch__deep_conflict_chain_cycles_lowest_arenas },
+	{ "all_arenas_in_conflict_panics", memory__scratch__all_arenas_in_conflict_panics },
 	{ "non_scratch_conflict_still_returns_arena", memory__scratch__non_scratch_conflict_still_returns_arena },
 	{ "nested_caller_callee_use_different_arenas", memory__scratch__nested_caller_callee_use_different_arenas },
 	{ "nested_inner_release_does_not_corrupt_outer", memory__scratch__nested_inner_release_does_not_corrupt_outer },
@@ -126,6 +266,7 @@ TestSuite MEMORY__memory__scratch__tests[] = {
 	{ "alloc_before_and_after_inner_scope_both_survive", memory__scratch__alloc_before_and_after_inner_scope_both_survive },
 	{ "sarena_nested_scopes_lifo_ordering", memory__scratch__sarena_nested_scopes_lifo_ordering },
 	{ "multiple_allocs_accumulate_before_release", memory__scratch__multiple_allocs_accumulate_before_release },
+	{ "concurrent_threads_use_isolated_arenas", memory__scratch__concurrent_threads_use_isolated_arenas },
 };
 
 TestSuite MEMORY__memory__arena__tests[] = {
@@ -144,6 +285,14 @@ TestSuite MEMORY__memory__buffer__tests[] = {
 	{ "typed_write_beyond_end_panics", memory__buffer__typed_write_beyond_end_panics },
 };
 
+TestSuite MEMORY__memory__pool__tests[] = {
+	{ "add_and_get", memory__pool__add_and_get },
+	{ "freed_handle_is_stale", memory__pool__freed_handle_is_stale },
+	{ "growth_keeps_addresses_stable", memory__pool__growth_keeps_addresses_stable },
+	{ "invalid_handles_return_null", memory__pool__invalid_handles_return_null },
+	{ "free_and_destroy_run_destructors", memory__pool__free_and_destroy_run_destructors },
+};
+
 TestSuite MEMORY__memory__macros__tests[] = {
 	{ "alloc_t_constructs_typed_object", memory__macros__alloc_t_constructs_typed_object },
 	{ "alloc_arr_allocates_typed_array", memory__macros__alloc_arr_allocates_typed_array },
@@ -156,12 +305,19 @@ TestSuite MEMORY__memory__macros__tests[] = {
 
 TestSuite MEMORY__tests[] = {
 	{ "memory/arena", nullptr, MEMORY__memory__arena__tests, sizeof(MEMORY__memory__arena__tests)/sizeof(MEMORY__memory__arena__tests[0]) },
+	{ "memory/arena_pool", nullptr, MEMORY__memory__arena_pool__tests, sizeof(MEMORY__memory__arena_pool__tests)/sizeof(MEMORY__memory__arena_pool__tests[0]) },
 	{ "memory/buffer", nullptr, MEMORY__memory__buffer__tests, sizeof(MEMORY__memory__buffer__tests)/sizeof(MEMORY__memory__buffer__tests[0]) },
 	{ "memory/linear", nullptr, MEMORY__memory__linear__tests, sizeof(MEMORY__memory__linear__tests)/sizeof(MEMORY__memory__linear__tests[0]) },
 	{ "memory/macros", nullptr, MEMORY__memory__macros__tests, sizeof(MEMORY__memory__macros__tests)/sizeof(MEMORY__memory__macros__tests[0]) },
 	{ "memory/malloc", nullptr, MEMORY__memory__malloc__tests, sizeof(MEMORY__memory__malloc__tests)/sizeof(MEMORY__memory__malloc__tests[0]) },
+	{ "memory/pool", nullptr, MEMORY__memory__pool__tests, sizeof(MEMORY__memory__pool__tests)/sizeof(MEMORY__memory__pool__tests[0]) },
 	{ "memory/scratch", nullptr, MEMORY__memory__scratch__tests, sizeof(MEMORY__memory__scratch__tests)/sizeof(MEMORY__memory__scratch__tests[0]) },
+	{ "memory/slab", nullptr, MEMORY__memory__slab__tests, sizeof(MEMORY__memory__slab__tests)/sizeof(MEMORY__memory__slab__tests[0]) },
+	{ "memory/telemetry", nullptr, MEMORY__memory__telemetry__tests, sizeof(MEMORY__memory__telemetry__tests)/sizeof(MEMORY__memory__telemetry__tests[0]) },
+	{ "memory/tl_block", nullptr, MEMORY__memory__tl_block__tests, sizeof(MEMORY__memory__tl_block__tests)/sizeof(MEMORY__memory__tl_block__tests[0]) },
+	{ "memory/tl_cache", nullptr, MEMORY__memory__tl_cache__tests, sizeof(MEMORY__memory__tl_cache__tests)/sizeof(MEMORY__memory__tl_cache__tests[0]) },
 	{ "memory/tl_linear", nullptr, MEMORY__memory__tl_linear__tests, sizeof(MEMORY__memory__tl_linear__tests)/sizeof(MEMORY__memory__tl_linear__tests[0]) },
+	{ "memory/tracking", nullptr, MEMORY__memory__tracking__tests, sizeof(MEMORY__memory__tracking__tests)/sizeof(MEMORY__memory__tracking__tests[0]) },
 	{ "memory/vm_freelist", nullptr, MEMORY__memory__vm_freelist__tests, sizeof(MEMORY__memory__vm_freelist__tests)/sizeof(MEMORY__memory__vm_freelist__tests[0]) },
 };
 
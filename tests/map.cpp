@@ -1,5 +1,6 @@
 #include "core/map.h"
 #include "core/test.h"
+#include "core/thread.h"
 
 TEST_PROC(dynamic_map__set_invokes_copy_constructor_for_key_and_value)
 {
@@ -16,7 +17,7 @@ TEST_PROC(dynamic_map__set_invokes_copy_constructor_for_key_and_value)
     ASSERT(TestType::move_assignment_calls == 0);
 }
 
-TEST_PROC(dynamic_map__growing_map_invokes_copy_constructors)
+TEST_PROC(dynamic_map__growing_map_invokes_move_constructors)
 {
     TestType::reset_counters();
     DynamicMap<TestType, TestType> map{};
@@ -29,8 +30,8 @@ TEST_PROC(dynamic_map__growing_map_invokes_copy_constructors)
     map_grow(&map, map.capacity+2);
     ASSERT(map.slots != old);
 
-    ASSERT(TestType::copy_constructor_calls == 12);
-    ASSERT(TestType::move_constructor_calls == 0);
+    ASSERT(TestType::copy_constructor_calls == 6);
+    ASSERT(TestType::move_constructor_calls == 6);
     ASSERT(TestType::copy_assignment_calls == 0);
     ASSERT(TestType::move_assignment_calls == 0);
 }
@@ -50,3 +51,478 @@ TEST_PROC(dynamic_map__set_of_existing_key_invokes_copy_assign_for_value_and_not
     ASSERT(TestType::copy_assignment_calls == 1);
     ASSERT(TestType::move_assignment_calls == 0);
 }
+
+TEST_PROC(dynamic_map__remove_keeps_colliding_keys_reachable)
+{
+    DynamicMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, i, i);
+    for (i32 i = 0; i < 1000; i += 2) map_remove(&map, i);
+    ASSERT(map.count == 500);
+
+    for (i32 i = 0; i < 1000; i++) {
+        i32 *value = map_find(&map, i);
+        if (i % 2 == 0) ASSERT(value == nullptr);
+        else ASSERT(value && *value == i);
+    }
+
+    for (i32 i = 1; i < 1000; i += 2) map_set(&map, i, -i);
+    ASSERT(map.count == 500);
+
+    i32 count = 0;
+    for (auto &it : map) {
+        ASSERT(it.value == -it.key);
+        count++;
+    }
+    ASSERT(count == 500);
+}
+
+TEST_PROC(dynamic_map__churn_does_not_grow_capacity)
+{
+    DynamicMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 64; i++) map_set(&map, i, i);
+    i32 capacity = map.capacity;
+
+    for (i32 i = 64; i < 100000; i++) {
+        map_remove(&map, i-64);
+        map_set(&map, i, i);
+    }
+
+    ASSERT(map.count == 64);
+    ASSERT(map.capacity == capacity);
+    for (i32 i = 100000-64; i < 100000; i++) ASSERT(*map_find(&map, i) == i);
+}
+
+TEST_PROC(dynamic_map__compact_shrinks_and_keeps_entries)
+{
+    DynamicMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, i, i);
+    for (i32 i = 10; i < 1000; i++) map_remove(&map, i);
+
+    i32 capacity = map.capacity;
+    map_compact(&map);
+    ASSERT(map.capacity < capacity);
+    ASSERT(map.count == 10);
+    for (i32 i = 0; i < 10; i++) ASSERT(*map_find(&map, i) == i);
+
+    for (i32 i = 0; i < 10; i++) map_remove(&map, i);
+    map_compact(&map);
+    ASSERT(map.capacity == 0 && map.slots == nullptr);
+    ASSERT(map_find(&map, 0) == nullptr);
+
+    map_set(&map, 1, 1);
+    ASSERT(*map_find(&map, 1) == 1);
+}
+
+TEST_PROC(dynamic_map__capacity_is_power_of_two_within_load_factor)
+{
+    DynamicMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 5000; i++) {
+        map_set(&map, i, i);
+        ASSERT((map.capacity & (map.capacity-1)) == 0);
+        ASSERT(map.count <= map.capacity*DYNAMIC_MAP_LOAD_FACTOR);
+    }
+
+    map_grow(&map, map.capacity+2);
+    ASSERT((map.capacity & (map.capacity-1)) == 0);
+    for (i32 i = 0; i < 5000; i++) ASSERT(*map_find(&map, i) == i);
+}
+
+TEST_PROC(dynamic_map__probe_distances_stay_ordered_under_churn)
+{
+    DynamicMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 2000; i++) map_set(&map, i, i);
+    for (i32 i = 0; i < 2000; i += 3) map_remove(&map, i);
+    for (i32 i = 2000; i < 2500; i++) map_set(&map, i, i);
+
+    i32 mask = map.capacity-1;
+    for (i32 i = 0; i < map.capacity; i++) {
+        auto &slot = map.slots[i];
+        auto &next = map.slots[(i+1) & mask];
+        if (slot.dist == 0) {
+            ASSERT(next.dist <= 1);
+            continue;
+        }
+
+        ASSERT((i32)((hash32(slot.key) + slot.dist-1) & mask) == i);
+        ASSERT(next.dist <= slot.dist+1);
+    }
+}
+
+TEST_PROC(dynamic_map__string_keys_survive_growth)
+{
+    DynamicMap<String, i32> map{};
+
+    for (i32 i = 0; i < 500; i++) map_set(&map, stringf(mem_dynamic, "key_%d", i), i);
+
+    char buffer[32];
+    for (i32 i = 0; i < 500; i++) {
+        i32 *value = map_find(&map, stringf(buffer, sizeof buffer, "key_%d", i));
+        ASSERT(value && *value == i);
+    }
+
+    ASSERT(map_find(&map, String("key_500")) == nullptr);
+}
+
+TEST_PROC(dynamic_map__small_array_values_survive_rehash)
+{
+    DynamicMap<i32, SmallArray<i32, 2>> map{};
+
+    for (i32 i = 0; i < 400; i++) {
+        auto *values = map_find_emplace(&map, i % 40);
+        array_add(values, i);
+    }
+
+    for (i32 i = 0; i < 40; i += 2) map_remove(&map, i);
+
+    for (i32 i = 1; i < 40; i += 2) {
+        auto *values = map_find(&map, i);
+        ASSERT(values && values->count == 10);
+        for (i32 j = 0; j < 10; j++) ASSERT(values->at(j) == i + j*40);
+    }
+}
+
+TEST_PROC(dynamic_map__remove_releases_small_array_values)
+{
+    Allocator tracked = tracking_allocator(malloc_allocator());
+    DynamicMap<i32, SmallArray<i32, 2>> map{};
+
+    {
+        SmallArray<i32, 2> values(tracked);
+        for (i32 i = 0; i < 4; i++) array_add(&values, i);
+        for (i32 i = 0; i < 8; i++) map_set(&map, i, values);
+    }
+
+    ASSERT(get_allocator_info(tracked).used > 0);
+
+    for (i32 i = 0; i < 8; i++) map_remove(&map, i);
+    ASSERT(map.count == 0);
+    ASSERT(get_allocator_info(tracked).used == 0);
+}
+
+TEST_PROC(swiss_map__set_then_find_returns_value)
+{
+    SwissMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, i, i*2);
+    ASSERT(map.count == 1000);
+
+    for (i32 i = 0; i < 1000; i++) {
+        i32 *value = map_find(&map, i);
+        ASSERT(value && *value == i*2);
+    }
+
+    ASSERT(map_find(&map, 1000) == nullptr);
+    ASSERT(map_find(&map, -1) == nullptr);
+}
+
+TEST_PROC(swiss_map__set_of_existing_key_replaces_value)
+{
+    SwissMap<i32, i32> map{};
+
+    map_set(&map, 1, 1);
+    map_set(&map, 1, 2);
+
+    ASSERT(map.count == 1);
+    ASSERT(*map_find(&map, 1) == 2);
+}
+
+TEST_PROC(swiss_map__capacity_is_power_of_two_within_load_factor)
+{
+    SwissMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 5000; i++) {
+        map_set(&map, i, i);
+        ASSERT((map.capacity & (map.capacity-1)) == 0);
+        ASSERT(map.count <= map.capacity*SWISS_MAP_LOAD_FACTOR);
+    }
+}
+
+TEST_PROC(swiss_map__remove_keeps_other_keys_reachable)
+{
+    SwissMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, i, i);
+    for (i32 i = 0; i < 1000; i += 2) map_remove(&map, i);
+    ASSERT(map.count == 500);
+
+    for (i32 i = 0; i < 1000; i++) {
+        i32 *value = map_find(&map, i);
+        if (i % 2 == 0) ASSERT(value == nullptr);
+        else ASSERT(value && *value == i);
+    }
+
+    for (i32 i = 0; i < 1000; i += 2) map_set(&map, i, -i);
+    ASSERT(map.count == 1000);
+    for (i32 i = 0; i < 1000; i += 2) ASSERT(*map_find(&map, i) == -i);
+}
+
+TEST_PROC(swiss_map__churn_does_not_grow_capacity)
+{
+    SwissMap<i32, i32> map{};
+
+    for (i32 i = 0; i < 64; i++) map_set(&map, i, i);
+    i32 capacity = map.capacity;
+
+    for (i32 i = 64; i < 100000; i++) {
+        map_remove(&map, i-64);
+        map_set(&map, i, i);
+    }
+
+    ASSERT(map.count == 64);
+    ASSERT(map.capacity == capacity);
+    for (i32 i = 100000-64; i < 100000; i++) ASSERT(*map_find(&map, i) == i);
+}
+
+TEST_PROC(swiss_map__find_emplace_inserts_default_once)
+{
+    SwissMap<i32, i32> map{};
+
+    i32 *a = map_find_emplace(&map, 7);
+    ASSERT(a && *a == 0);
+    *a = 3;
+
+    i32 *b = map_find_emplace(&map, 7, 5);
+    ASSERT(b == a && *b == 3);
+    ASSERT(*map_find_emplace(&map, 8, 5) == 5);
+    ASSERT(map.count == 2);
+}
+
+TEST_PROC(swiss_map__string_keys)
+{
+    SwissMap<String, i32> map{};
+
+    map_set(&map, "foo", 1);
+    map_set(&map, "bar", 2);
+
+    ASSERT(*map_find(&map, String("foo")) == 1);
+    ASSERT(*map_find(&map, String("bar")) == 2);
+    ASSERT(map_find(&map, String("baz")) == nullptr);
+}
+
+struct NeqOnlyKey {
+    i32 value;
+    bool operator!=(const NeqOnlyKey &rhs) { return value != rhs.value; }
+};
+
+inline h32 hash32(const NeqOnlyKey &key, h32 seed = HASH32_SEED)
+{
+    return hash32(key.value, seed);
+}
+
+TEST_PROC(swiss_map__keys_with_only_inequality)
+{
+    SwissMap<NeqOnlyKey, i32> map{};
+
+    map_set(&map, { 1 }, 1);
+    map_set(&map, { 2 }, 2);
+    map_set(&map, { 1 }, 3);
+
+    ASSERT(map.count == 2);
+    ASSERT(*map_find(&map, NeqOnlyKey{ 1 }) == 3);
+    ASSERT(*map_find(&map, NeqOnlyKey{ 2 }) == 2);
+    ASSERT(map_find(&map, NeqOnlyKey{ 3 }) == nullptr);
+}
+
+TEST_PROC(swiss_map__iterates_every_pair_once)
+{
+    SwissMap<i32, i32> map{};
+    for (i32 i = 0; i < 100; i++) map_set(&map, i, i);
+    for (i32 i = 0; i < 100; i += 3) map_remove(&map, i);
+
+    i32 count = 0, sum = 0;
+    for (auto &it : map) {
+        ASSERT(it.key == it.value);
+        count++;
+        sum += it.key;
+    }
+
+    i32 expected = 0;
+    for (i32 i = 0; i < 100; i++) if (i % 3 != 0) expected += i;
+
+    ASSERT(count == map.count);
+    ASSERT(sum == expected);
+}
+
+TEST_PROC(sorted_map__iterates_in_key_order)
+{
+    SortedMap<i32, i32> map{};
+    defer { map_reset(&map); };
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, (i*7919) % 1000, i);
+    map_set(&map, 5, -5);
+    ASSERT(map.keys.count == 1000);
+    ASSERT(*map_find(&map, 5) == -5);
+    ASSERT(map_find(&map, 1000) == nullptr);
+
+    i32 expected = 0;
+    for (auto it : map) ASSERT(it.key == expected++);
+
+    for (i32 i = 0; i < 1000; i += 2) map_remove(&map, i);
+    ASSERT(map.keys.count == 500);
+    ASSERT(map_find(&map, 4) == nullptr);
+    ASSERT(map_find(&map, 7) != nullptr);
+}
+
+TEST_PROC(sorted_map__range_is_half_open)
+{
+    SortedMap<i32, i32> map{};
+    defer { map_reset(&map); };
+
+    for (i32 i = 0; i < 100; i += 10) map_set(&map, i, i);
+
+    auto range = map_range(&map, 15, 50);
+    ASSERT(range.count() == 3);
+
+    i32 expected = 20;
+    for (auto it : range) {
+        ASSERT(it.key == expected);
+        expected += 10;
+    }
+
+    ASSERT(map_range(&map, 50, 15).count() == 0);
+    ASSERT(map_range(&map, 200, 300).count() == 0);
+    ASSERT(map_lower_bound(&map, 20) == 2);
+    ASSERT(map_upper_bound(&map, 20) == 3);
+}
+
+TEST_PROC(sorted_map__set_batch_merges_and_last_duplicate_wins)
+{
+    SortedMap<i32, i32> map{};
+    defer { map_reset(&map); };
+
+    map_set(&map, 2, 0);
+    map_set(&map, 4, 0);
+    map_set(&map, 8, 0);
+
+    i32 keys[]   = { 9, 4, 1, 4, 6, 1 };
+    i32 values[] = { 1, 2, 3, 4, 5, 6 };
+    map_set_batch(&map, ARRAY(keys), ARRAY(values));
+
+    i32 expected_keys[]   = { 1, 2, 4, 6, 8, 9 };
+    i32 expected_values[] = { 6, 0, 4, 5, 0, 1 };
+    ASSERT(map.keys == ARRAY(expected_keys));
+    ASSERT(map.values == ARRAY(expected_values));
+}
+
+TEST_PROC(sorted_map__string_keys)
+{
+    SortedMap<String, i32> map{};
+    defer { map_reset(&map); };
+
+    map_set(&map, String("beta"), 2);
+    map_set(&map, String("alpha"), 1);
+    *map_find_emplace(&map, String("gamma")) = 3;
+
+    ASSERT(*map_find(&map, String("alpha")) == 1);
+    ASSERT(map.keys[0] == String("alpha"));
+    ASSERT(map.keys[2] == String("gamma"));
+}
+
+struct ConcurrentMapThreadData {
+    ConcurrentMap<i32, i32> *map;
+    i32 index;
+    i32 shared[256];
+};
+
+static i32 concurrent_map_thread_proc(void *user_data)
+{
+    auto data = (ConcurrentMapThreadData*)user_data;
+    for (i32 i = 0; i < 5000; i++) map_set(data->map, data->index*100000 + i, i);
+
+    for (i32 i = 0; i < ARRAY_COUNT(data->shared); i++) {
+        data->shared[i] = map_find_emplace(data->map, -1-i, data->index);
+    }
+
+    return 0;
+}
+
+TEST_PROC(concurrent_map__set_and_find)
+{
+    ConcurrentMap<i32, i32> map{};
+    defer { map_reset(&map); };
+
+    for (i32 i = 0; i < 1000; i++) map_set(&map, i, i*2);
+    ASSERT(map_count(&map) == 1000);
+
+    i32 value;
+    for (i32 i = 0; i < 1000; i++) ASSERT(map_find(&map, i, &value) && value == i*2);
+    ASSERT(!map_find(&map, 1000, &value));
+
+    ASSERT(!map_insert(&map, 1, 3));
+    ASSERT(map_insert(&map, 1000, 3));
+    ASSERT(map_find(&map, 1, &value) && value == 2);
+
+    for (i32 i = 0; i < 1000; i += 2) map_remove(&map, i);
+    ASSERT(map_count(&map) == 501);
+    ASSERT(!map_find(&map, 0, &value));
+    ASSERT(map_find(&map, 1, &value));
+}
+
+TEST_PROC(concurrent_map__concurrent_inserts_agree)
+{
+    ConcurrentMap<i32, i32> map{};
+    defer { map_reset(&map); };
+
+    Thread *threads[4];
+    ConcurrentMapThreadData data[4];
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        data[i] = {};
+        data[i].map = &map;
+        data[i].index = i+1;
+        threads[i] = create_thread(concurrent_map_thread_proc, &data[i]);
+    }
+
+    for (Thread *t : threads) join_thread(t);
+
+    ASSERT(map_count(&map) == ARRAY_COUNT(data)*5000 + ARRAY_COUNT(data[0].shared));
+
+    i32 value;
+    for (auto &d : data) {
+        for (i32 i = 0; i < 5000; i++) ASSERT(map_find(&map, d.index*100000 + i, &value) && value == i);
+
+        for (i32 i = 0; i < ARRAY_COUNT(d.shared); i++) {
+            ASSERT(map_find(&map, -1-i, &value) && value == d.shared[i]);
+        }
+    }
+}
+
+struct ConcurrentMapReaderData {
+    ConcurrentMap<i32, i32> *map;
+    volatile i32 *stop;
+};
+
+static i32 concurrent_map_reader_proc(void *user_data)
+{
+    auto data = (ConcurrentMapReaderData*)user_data;
+
+    i32 value;
+    while (!atomic_load(data->stop)) map_find(data->map, 0, &value);
+    return 0;
+}
+
+TEST_PROC(concurrent_map__writer_progresses_under_constant_reads)
+{
+    ConcurrentMap<i32, i32> map{};
+    defer { map_reset(&map); };
+    map_set(&map, 0, -1);
+
+    volatile i32 stop = 0;
+    ConcurrentMapReaderData data{ .map = &map, .stop = &stop };
+
+    Thread *threads[8];
+    for (Thread *&t : threads) t = create_thread(concurrent_map_reader_proc, &data);
+
+    // every write goes to the stripe the readers are holding
+    for (i32 i = 0; i < 1000; i++) map_set(&map, 0, i);
+
+    atomic_exchange(&stop, 1);
+    for (Thread *t : threads) join_thread(t);
+
+    i32 value;
+    ASSERT(map_find(&map, 0, &value) && value == 999);
+}
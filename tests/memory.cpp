@@ -1,5 +1,6 @@
 #include "core/memory.h"
 #include "core/test.h"
+#include "core/thread.h"
 
 static bool is_aligned(void *ptr, u8 alignment)
 {
@@ -29,6 +30,11 @@ static i64 vm_freelist_near_exact_page_request_size(VMFreeListState *state, u8 a
     return vm_freelist_exact_page_request_size(state, alignment) - ((i64)sizeof(VMFreeListState::Block) - 1);
 }
 
+static VMFreeListState::Header* vm_freelist_header(void *ptr)
+{
+    return (VMFreeListState::Header*)ptr - 1;
+}
+
 TEST_PROC(memory__tl_linear__alloc_returns_nonnull)
 {
     Allocator a = tl_linear_allocator(4096);
@@ -233,6 +239,140 @@ TEST_PROC(memory__tl_linear__alloc_beyond_capacity_panics)
     EXPECT_FAIL(ALLOC(a, 1024));
 }
 
+TEST_PROC(memory__tl_linear__alloc_commits_pages_on_demand)
+{
+    Allocator a = tl_linear_allocator(64 * MiB);
+
+    u8 *p0 = (u8*)ALLOC(a, 3 * MiB);
+    memset(p0, 0xcd, 3 * MiB);
+
+    u8 *p1 = (u8*)ALLOC(a, 100);
+    memset(p1, 0xab, 100);
+
+    ASSERT(p0[3 * MiB - 1] == 0xcd);
+    ASSERT(p1[99] == 0xab);
+}
+
+TEST_PROC(memory__tl_linear__realloc_inplace_commits_pages)
+{
+    Allocator a = tl_linear_allocator(64 * MiB);
+
+    u8 *p = (u8*)ALLOC(a, 16);
+    for (i32 i = 0; i < 16; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC(a, p, 16, 2 * MiB);
+    ASSERT(r == p);
+    memset(r + 16, 0xcd, 2 * MiB - 16);
+
+    for (i32 i = 0; i < 16; i++) ASSERT(r[i] == (u8)i);
+}
+
+TEST_PROC(memory__tl_linear__reset_decommits_and_recommits)
+{
+    Allocator a = tl_linear_allocator(64 * MiB);
+
+    u8 *p0 = (u8*)ALLOC(a, 8 * MiB);
+    memset(p0, 0xcd, 8 * MiB);
+
+    RESET_ALLOC(a);
+
+    u8 *p1 = (u8*)ALLOC(a, 8 * MiB);
+    ASSERT(p1 == p0);
+    memset(p1, 0xab, 8 * MiB);
+    ASSERT(p1[8 * MiB - 1] == 0xab);
+}
+
+TEST_PROC(memory__tl_linear__restore_point_reset_keeps_committed)
+{
+    Allocator a = tl_linear_allocator(64 * MiB);
+
+    void *restore_point = ALLOC(a, 1);
+    u8 *p0 = (u8*)ALLOC(a, 8 * MiB);
+    memset(p0, 0xcd, 8 * MiB);
+
+    i64 committed = get_allocator_info(a).committed;
+    RESTORE_ALLOC(a, restore_point);
+    ASSERT(get_allocator_info(a).committed == committed);
+
+    RESET_ALLOC(a);
+    ASSERT(get_allocator_info(a).committed < committed);
+}
+
+TEST_PROC(memory__tl_linear__reset_poisons_released_memory)
+{
+    Allocator a = tl_linear_allocator(4096);
+
+    u8 *p0 = (u8*)ALLOC(a, 64);
+    memset(p0, 0xab, 64);
+
+    void *restore_point = ALLOC(a, 1);
+    u8 *p1 = (u8*)ALLOC(a, 64);
+    memset(p1, 0xab, 64);
+
+    RESTORE_ALLOC(a, restore_point);
+
+    for (i32 i = 0; i < 64; i++) ASSERT(p0[i] == 0xab);
+#if M_DEBUG_ARENAS
+    for (i32 i = 0; i < 64; i++) ASSERT(p1[i] == M_ARENA_POISON_BYTE);
+#else
+    for (i32 i = 0; i < 64; i++) ASSERT(p1[i] == 0xab);
+#endif
+}
+
+TEST_PROC(memory__tl_linear__reset_detects_overrun)
+{
+    Allocator a = tl_linear_allocator(4096);
+
+    ALLOC(a, 64);
+    u8 *p = (u8*)ALLOC(a, 64);
+    p[64] = 0;
+
+#if M_DEBUG_ARENAS
+    EXPECT_FAIL(RESTORE_ALLOC(a, p));
+#else
+    RESTORE_ALLOC(a, p);
+#endif
+}
+
+TEST_PROC(memory__tl_linear__realloc_inplace_moves_redzone)
+{
+    Allocator a = tl_linear_allocator(4096);
+
+    u8 *p = (u8*)ALLOC(a, 16);
+    u8 *r = (u8*)REALLOC(a, p, 16, 64);
+    ASSERT(r == p);
+    memset(r, 0xab, 64);
+
+    RESET_ALLOC(a);
+}
+
+TEST_PROC(memory__tl_linear__numa_local_is_reported_and_usable)
+{
+    Allocator a = tl_linear_allocator(64 * MiB, M_NUMA_LOCAL);
+
+    u8 *p = (u8*)ALLOC(a, 4 * MiB);
+    memset(p, 0xab, 4 * MiB);
+    ASSERT(p[4 * MiB - 1] == 0xab);
+
+    // NOTE(jesper): mbind is unavailable on kernels without NUMA support, and
+    // in some sandboxes, in which case the flag isn't obtained
+    AllocatorInfo info = get_allocator_info(a);
+    if (info.flags & M_NUMA_LOCAL) {
+        ASSERT(info.numa_node >= 0);
+    } else {
+        ASSERT(info.numa_node == -1);
+    }
+}
+
+TEST_PROC(memory__tl_linear__default_flags_report_no_numa_node)
+{
+    Allocator a = tl_linear_allocator(4096);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT((info.flags & M_NUMA_LOCAL) == 0);
+    ASSERT(info.numa_node == -1);
+}
+
 TEST_PROC(memory__tl_linear__get_allocator_info_reports_usage)
 {
     SArena scratch = tl_scratch_arena();
@@ -248,6 +388,283 @@ TEST_PROC(memory__tl_linear__get_allocator_info_reports_usage)
     ASSERT(after.size == before.size);
 }
 
+TEST_PROC(memory__tl_block__alloc_beyond_block_size_chains_new_block)
+{
+    Allocator a = tl_block_allocator(256, malloc_allocator());
+
+    u8 *p0 = (u8*)ALLOC(a, 200);
+    u8 *p1 = (u8*)ALLOC(a, 200);
+    u8 *p2 = (u8*)ALLOC(a, 1024);
+    ASSERT(p0 && p1 && p2);
+
+    ASSERT(!is_overlapping(p0, 200, p1, 200));
+    ASSERT(!is_overlapping(p1, 200, p2, 1024));
+
+    memset(p0, 0x11, 200);
+    memset(p1, 0x22, 200);
+    memset(p2, 0x33, 1024);
+    ASSERT(p0[199] == 0x11);
+    ASSERT(p1[199] == 0x22);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.size >= 256 + 256 + 1024);
+    ASSERT(info.used >= 200 + 200 + 1024);
+}
+
+TEST_PROC(memory__tl_block__restore_point_across_blocks)
+{
+    Allocator a = tl_block_allocator(256, malloc_allocator());
+
+    ALLOC(a, 200);
+    void *restore_point = ALLOC(a, 1);
+    AllocatorInfo before = get_allocator_info(a);
+
+    ALLOC(a, 200);
+    ALLOC(a, 1024);
+
+    RESTORE_ALLOC(a, restore_point);
+
+    AllocatorInfo after = get_allocator_info(a);
+    ASSERT(after.size == before.size);
+
+    void *p = ALLOC(a, 1);
+    ASSERT(p == restore_point);
+}
+
+TEST_PROC(memory__tl_block__reset_recycles_block)
+{
+    Allocator a = tl_block_allocator(256, malloc_allocator());
+
+    void *p0 = ALLOC(a, 200);
+    void *p1 = ALLOC(a, 200);
+
+    RESET_ALLOC(a);
+    ASSERT(ALLOC(a, 200) == p0);
+
+    void *p2 = ALLOC(a, 200);
+    ASSERT(p2 == p1);
+}
+
+TEST_PROC(memory__tl_block__realloc_last_alloc_is_inplace)
+{
+    Allocator a = tl_block_allocator(1024, malloc_allocator());
+
+    u8 *p = (u8*)ALLOC(a, 16);
+    for (i32 i = 0; i < 16; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC(a, p, 16, 512);
+    ASSERT(r == p);
+
+    r = (u8*)REALLOC(a, r, 512, 4096);
+    ASSERT(r != p);
+    for (i32 i = 0; i < 16; i++) ASSERT(r[i] == (u8)i);
+}
+
+TEST_PROC(memory__tl_block__arena_grows_past_initial_size)
+{
+    MArena arena = tl_arena(1024);
+
+    u8 *p = (u8*)ALLOC(arena, 64 * KiB);
+    ASSERT(p != nullptr);
+    memset(p, 0xcd, 64 * KiB);
+
+    restore_arena(&arena);
+    AllocatorInfo info = get_allocator_info(arena);
+    ASSERT(info.used == 0);
+}
+
+TEST_PROC(memory__arena_pool__release_then_acquire_reuses_arena)
+{
+    MArena a = tl_arena(4000);
+    void *state = a.state;
+    void *p0 = ALLOC(a, 1024);
+    release_arena(&a);
+
+    MArena b = tl_arena(3000);
+    ASSERT(b.state == state);
+
+    AllocatorInfo info = get_allocator_info(b);
+    ASSERT(info.used == 0);
+
+    void *p1 = ALLOC(b, 1024);
+    ASSERT(p1 == p0);
+    release_arena(&b);
+}
+
+TEST_PROC(memory__arena_pool__size_classes_are_kept_apart)
+{
+    MArena a = tl_arena(1 * KiB);
+    void *state = a.state;
+    release_arena(&a);
+
+    MArena b = tl_arena(64 * KiB);
+    ASSERT(b.state != state);
+
+    MArena c = tl_arena(1 * KiB);
+    ASSERT(c.state == state);
+
+    release_arena(&c);
+    release_arena(&b);
+}
+
+TEST_PROC(memory__arena_pool__released_arena_drops_extra_blocks)
+{
+    MArena a = tl_arena(1 * KiB);
+    ALLOC(a, 512);
+    ALLOC(a, 4 * KiB);
+    ALLOC(a, 4 * KiB);
+    release_arena(&a);
+
+    MArena b = tl_arena(1 * KiB);
+    AllocatorInfo info = get_allocator_info(b);
+    ASSERT(info.used == 0);
+    ASSERT(info.size == 1 * KiB);
+    release_arena(&b);
+}
+
+TEST_PROC(memory__linear__reset_decommits_and_recommits)
+{
+    Allocator a = linear_allocator(64 * MiB);
+
+    u8 *p0 = (u8*)ALLOC(a, 8 * MiB);
+    memset(p0, 0xcd, 8 * MiB);
+
+    RESET_ALLOC(a);
+
+    u8 *p1 = (u8*)ALLOC(a, 8 * MiB);
+    ASSERT(p1 == p0);
+    memset(p1, 0xab, 8 * MiB);
+    ASSERT(p1[8 * MiB - 1] == 0xab);
+}
+
+TEST_PROC(memory__linear__extend_last_alloc_is_inplace)
+{
+    Allocator a = linear_allocator(4096);
+
+    u8 *p0 = (u8*)ALLOC(a, 64);
+    u8 *p1 = (u8*)ALLOC_PROC(a, M_EXTEND, p0, 64, 128, M_DEFAULT_ALIGN);
+    ASSERT(p1 == p0);
+
+    void *p2 = ALLOC(a, 16);
+    ASSERT(!is_overlapping(p1, 128, p2, 16));
+
+    // no longer the last allocation, so a new allocation is returned
+    u8 *p3 = (u8*)REALLOC(a, p1, 128, 256);
+    ASSERT(p3 != p1);
+    ASSERT(!is_overlapping(p3, 256, p2, 16));
+}
+
+TEST_PROC(memory__linear__zero_size_alloc_ends_inplace_extend)
+{
+    Allocator a = linear_allocator(4096);
+
+    u8 *p0 = (u8*)ALLOC(a, 64);
+    void *p1 = ALLOC(a, 0);
+
+    // p1 is the last allocation now, even though it's empty
+    u8 *p2 = (u8*)REALLOC(a, p0, 64, 128);
+    ASSERT(p2 != p0);
+    ASSERT(!is_overlapping(p2, 128, p1, 1));
+}
+
+struct LinearAllocThreadData {
+    Allocator alloc;
+    i32 index;
+    u8 *ptrs[1000];
+};
+
+static i32 linear_alloc_thread_proc(void *user_data)
+{
+    auto data = (LinearAllocThreadData*)user_data;
+    for (u8 *&p : data->ptrs) {
+        p = (u8*)ALLOC(data->alloc, 24);
+        memset(p, data->index, 24);
+    }
+
+    return 0;
+}
+
+TEST_PROC(memory__linear__concurrent_allocs_dont_overlap)
+{
+    Allocator a = linear_allocator(4 * MiB);
+
+    Thread *threads[4];
+    LinearAllocThreadData data[4];
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        data[i] = {};
+        data[i].alloc = a;
+        data[i].index = i+1;
+        threads[i] = create_thread(linear_alloc_thread_proc, &data[i]);
+    }
+
+    for (Thread *t : threads) join_thread(t);
+
+    for (auto &d : data) {
+        for (u8 *p : d.ptrs) {
+            for (i32 i = 0; i < 24; i++) ASSERT(p[i] == d.index);
+        }
+    }
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used >= ARRAY_COUNT(data) * 1000 * 24);
+}
+
+TEST_PROC(memory__linear__reset_detects_overrun)
+{
+    Allocator a = linear_allocator(4096);
+
+    u8 *p0 = (u8*)ALLOC(a, 64);
+    u8 *p1 = (u8*)ALLOC(a, 64);
+    memset(p1, 0xab, 64);
+    p0[64] = 0;
+
+#if M_DEBUG_ARENAS
+    EXPECT_FAIL(RESET_ALLOC(a));
+    for (i32 i = 0; i < 64; i++) ASSERT(p1[i] == 0xab);
+#else
+    RESET_ALLOC(a);
+#endif
+}
+
+TEST_PROC(memory__linear__huge_pages_are_reported_and_usable)
+{
+    Allocator a = linear_allocator(8 * MiB, M_HUGE_PAGES);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.flags == 0 || info.flags == M_HUGE_PAGES);
+    if (info.flags & M_HUGE_PAGES) ASSERT((size_t)a.state % M_HUGE_PAGE_SIZE == 0);
+
+    u8 *p = (u8*)ALLOC(a, 5 * MiB);
+    memset(p, 0xcd, 5 * MiB);
+    ASSERT(p[5 * MiB - 1] == 0xcd);
+
+    RESET_ALLOC(a);
+    p = (u8*)ALLOC(a, 5 * MiB);
+    memset(p, 0xab, 5 * MiB);
+    ASSERT(p[5 * MiB - 1] == 0xab);
+}
+
+TEST_PROC(memory__linear__explicit_huge_pages_fall_back)
+{
+    Allocator a = tl_linear_allocator(4 * MiB, M_HUGE_PAGES_EXPLICIT);
+
+    // which kind of pages are obtained depends on the system's
+    // huge page pool and transparent huge page settings
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.flags == 0 || info.flags == M_HUGE_PAGES || info.flags == M_HUGE_PAGES_EXPLICIT);
+
+    u8 *p = (u8*)ALLOC(a, 3 * MiB);
+    memset(p, 0xcd, 3 * MiB);
+    ASSERT(p[3 * MiB - 1] == 0xcd);
+}
+
+TEST_PROC(memory__linear__default_flags_report_no_huge_pages)
+{
+    Allocator a = linear_allocator(4096);
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.flags == 0);
+}
+
 TEST_PROC(memory__linear__get_allocator_info_reports_usage)
 {
     Allocator a = linear_allocator(256);
@@ -296,197 +713,821 @@ TEST_PROC(memory__malloc__alloc_respects_alignment)
     ASSERT(is_aligned(p32, 32));
     ASSERT(is_aligned(p64, 64));
 
-    FREE(a, p4);
-    FREE(a, p8);
-    FREE(a, p16);
-    FREE(a, p32);
-    FREE(a, p64);
+    FREE(a, p4);
+    FREE(a, p8);
+    FREE(a, p16);
+    FREE(a, p32);
+    FREE(a, p64);
+}
+
+TEST_PROC(memory__malloc__free_null_is_safe)
+{
+    Allocator a = malloc_allocator();
+    // Freeing nullptr must not crash (guarded by `if (old_ptr)` in malloc_alloc)
+    void *ret = FREE(a, nullptr);
+    ASSERT(ret == nullptr);
+}
+
+TEST_PROC(memory__malloc__realloc_preserves_data)
+{
+    Allocator a = malloc_allocator();
+
+    u8 *p = (u8*)ALLOC(a, 64);
+    for (i32 i = 0; i < 64; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC(a, p, 64, 128);
+    ASSERT(r != nullptr);
+    for (i32 i = 0; i < 64; i++) ASSERT(r[i] == (u8)i);
+
+    FREE(a, r);
+}
+
+TEST_PROC(memory__malloc__realloc_null_ptr_acts_as_alloc)
+{
+    Allocator a = malloc_allocator();
+    void *p = REALLOC(a, nullptr, 0, 64);
+    ASSERT(p != nullptr);
+    FREE(a, p);
+}
+
+TEST_PROC(memory__malloc__extend_is_fresh_alloc_no_copy)
+{
+    Allocator a = malloc_allocator();
+
+    u8 *p = (u8*)ALLOC(a, 64);
+    for (i32 i = 0; i < 64; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)ALLOC_PROC(a, M_EXTEND, p, 64, 128, M_DEFAULT_ALIGN);
+    ASSERT(r != nullptr);
+    ASSERT(r != p);
+    // Old pointer is NOT freed by extend -- caller is responsible.
+    FREE(a, p);
+    FREE(a, r);
+}
+
+TEST_PROC(memory__malloc__reset_logs_error_and_returns_null)
+{
+    Allocator a = malloc_allocator();
+    EXPECT_FAIL(RESET_ALLOC(a));
+}
+
+TEST_PROC(memory__malloc__large_alloc_respects_alignment)
+{
+    Allocator a = malloc_allocator();
+
+    u8 *p16 = (u8*)ALLOC_A(a, M_MALLOC_LARGE_SIZE, 16);
+    u8 *p64 = (u8*)ALLOC_A(a, M_MALLOC_LARGE_SIZE, 64);
+    ASSERT(is_aligned(p16, 16));
+    ASSERT(is_aligned(p64, 64));
+
+    memset(p64, 0xcd, M_MALLOC_LARGE_SIZE);
+    ASSERT(p64[M_MALLOC_LARGE_SIZE-1] == 0xcd);
+
+    FREE(a, p16);
+    FREE(a, p64);
+}
+
+TEST_PROC(memory__malloc__realloc_into_large_preserves_data)
+{
+    Allocator a = malloc_allocator();
+
+    u8 *p = (u8*)ALLOC(a, 1024);
+    for (i32 i = 0; i < 1024; i++) p[i] = (u8)i;
+
+    p = (u8*)REALLOC(a, p, 1024, 4 * MiB);
+    for (i32 i = 0; i < 1024; i++) ASSERT(p[i] == (u8)i);
+
+    p[4 * MiB - 1] = 0xab;
+    p = (u8*)REALLOC(a, p, 4 * MiB, 32 * MiB);
+    for (i32 i = 0; i < 1024; i++) ASSERT(p[i] == (u8)i);
+    ASSERT(p[4 * MiB - 1] == 0xab);
+
+    p = (u8*)REALLOC(a, p, 32 * MiB, 2 * MiB);
+    for (i32 i = 0; i < 1024; i++) ASSERT(p[i] == (u8)i);
+
+    FREE(a, p);
+}
+
+TEST_PROC(memory__malloc__extend_large_preserves_data_when_inplace)
+{
+    Allocator a = malloc_allocator();
+
+    u8 *p = (u8*)ALLOC(a, 2 * MiB);
+    memset(p, 0xcd, 2 * MiB);
+
+    u8 *q = (u8*)ALLOC_PROC(a, M_EXTEND, p, 2 * MiB, 8 * MiB, M_DEFAULT_ALIGN);
+    if (q == p) {
+        ASSERT(q[2 * MiB - 1] == 0xcd);
+    } else {
+        FREE(a, p);
+    }
+
+    memset(q, 0xab, 8 * MiB);
+    FREE(a, q);
+}
+
+TEST_PROC(memory__malloc__get_allocator_info_reports_no_capacity)
+{
+    Allocator a = malloc_allocator();
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.size == 0);
+    ASSERT(info.fragmentation == 0.0f);
+}
+
+TEST_PROC(memory__malloc__get_allocator_info_tracks_alloc_and_free)
+{
+    Allocator a = malloc_allocator();
+    AllocatorInfo before = get_allocator_info(a);
+
+    void *p = ALLOC(a, 256);
+    ASSERT(p != nullptr);
+
+    AllocatorInfo after_alloc = get_allocator_info(a);
+    ASSERT(after_alloc.size == 0);
+    ASSERT(after_alloc.used == before.used + 256);
+    ASSERT(after_alloc.peak >= after_alloc.used);
+    ASSERT(after_alloc.alloc_count == before.alloc_count + 1);
+
+    p = REALLOC(a, p, 256, 1024);
+    AllocatorInfo after_realloc = get_allocator_info(a);
+    ASSERT(after_realloc.used == before.used + 1024);
+    ASSERT(after_realloc.alloc_count == after_alloc.alloc_count);
+
+    FREE(a, p);
+
+    AllocatorInfo after_free = get_allocator_info(a);
+    ASSERT(after_free.used == before.used);
+    ASSERT(after_free.peak >= before.used + 1024);
+}
+
+TEST_PROC(memory__vm_freelist__get_allocator_info_reports_capacity)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.size >= 4 * MiB);
+    ASSERT(info.used == 0);
+}
+
+TEST_PROC(memory__vm_freelist__get_allocator_info_tracks_alloc_and_free)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+
+    AllocatorInfo before = get_allocator_info(a);
+    void *p = ALLOC(a, 4096);
+    ASSERT(p != nullptr);
+
+    AllocatorInfo after_alloc = get_allocator_info(a);
+    ASSERT(after_alloc.used >= before.used + 4096);
+
+    FREE(a, p);
+
+    AllocatorInfo after_free = get_allocator_info(a);
+    ASSERT(after_free.used == before.used);
+    ASSERT(after_free.size == before.size);
+}
+
+TEST_PROC(memory__vm_freelist__near_exact_initial_alloc_succeeds)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+    auto *state = (VMFreeListState*)a.state;
+
+    void *p = ALLOC(a, vm_freelist_near_exact_page_request_size(state));
+    ASSERT(p != nullptr);
+    ASSERT(state->committed > 0);
+
+    FREE(a, p);
+}
+
+TEST_PROC(memory__vm_freelist__free_then_exact_fit_reuses_committed_page)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+    auto *state = (VMFreeListState*)a.state;
+
+    i64 size = vm_freelist_exact_page_request_size(state);
+
+    void *p0 = ALLOC(a, size);
+    ASSERT(p0 != nullptr);
+    i64 committed_after_first_alloc = state->committed;
+    ASSERT(committed_after_first_alloc > 0);
+
+    FREE(a, p0);
+    ASSERT(state->committed == committed_after_first_alloc);
+
+    void *p1 = ALLOC(a, size);
+    ASSERT(p1 != nullptr);
+    ASSERT(state->committed == committed_after_first_alloc);
+
+    FREE(a, p1);
+}
+
+TEST_PROC(memory__vm_freelist__free_then_near_exact_fit_reuses_committed_page)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+    auto *state = (VMFreeListState*)a.state;
+
+    i64 exact_size = vm_freelist_exact_page_request_size(state);
+    i64 near_size = vm_freelist_near_exact_page_request_size(state);
+
+    void *p0 = ALLOC(a, exact_size);
+    ASSERT(p0 != nullptr);
+
+    FREE(a, p0);
+    i64 committed_after_free = state->committed;
+    ASSERT(committed_after_free > 0);
+
+    void *p1 = ALLOC(a, near_size);
+    ASSERT(p1 != nullptr);
+    ASSERT(state->committed == committed_after_free);
+
+    FREE(a, p1);
+}
+
+TEST_PROC(memory__vm_freelist__alternating_near_page_sizes_do_not_grow_committed)
+{
+    Allocator a = vm_freelist_allocator(4 * MiB);
+    auto *state = (VMFreeListState*)a.state;
+
+    i64 near_size = vm_freelist_near_exact_page_request_size(state);
+
+    void *seed = ALLOC(a, vm_freelist_exact_page_request_size(state));
+    ASSERT(seed != nullptr);
+    FREE(a, seed);
+
+    i64 committed_baseline = state->committed;
+    ASSERT(committed_baseline > 0);
+
+    for (i32 i = 0; i < 8; i++) {
+        i64 size = (i & 1) ? near_size : vm_freelist_exact_page_request_size(state);
+
+        void *p = ALLOC(a, size);
+        ASSERT(p != nullptr);
+        ASSERT(state->committed == committed_baseline);
+
+        FREE(a, p);
+        ASSERT(state->committed == committed_baseline);
+    }
+}
+
+
+TEST_PROC(memory__vm_freelist__huge_pages_are_reported_and_usable)
+{
+    Allocator a = vm_freelist_allocator(64 * MiB, M_HUGE_PAGES);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.flags == 0 || info.flags == M_HUGE_PAGES);
+
+    u8 *p = (u8*)ALLOC(a, 3 * MiB);
+    memset(p, 0xcd, 3 * MiB);
+    ASSERT(p[3 * MiB - 1] == 0xcd);
+    FREE(a, p);
+}
+
+TEST_PROC(memory__tl_cache__alloc_returns_aligned_nonnull)
+{
+    Allocator a = tl_cache_allocator(vm_freelist_allocator(4 * MiB));
+
+    void *p0 = ALLOC(a, 1);
+    void *p1 = ALLOC(a, 24);
+    void *p2 = ALLOC(a, 2048);
+    ASSERT(p0 != nullptr);
+    ASSERT(p1 != nullptr);
+    ASSERT(p2 != nullptr);
+
+    ASSERT(is_aligned(p0, M_DEFAULT_ALIGN));
+    ASSERT(is_aligned(p1, M_DEFAULT_ALIGN));
+    ASSERT(is_aligned(p2, M_DEFAULT_ALIGN));
+
+    FREE(a, p0);
+    FREE(a, p1);
+    FREE(a, p2);
+}
+
+TEST_PROC(memory__tl_cache__free_then_alloc_same_class_reuses_block)
+{
+    Allocator a = tl_cache_allocator(vm_freelist_allocator(4 * MiB));
+
+    void *p0 = ALLOC(a, 48);
+    FREE(a, p0);
+
+    void *p1 = ALLOC(a, 60);
+    ASSERT(p1 == p0);
+    FREE(a, p1);
+}
+
+TEST_PROC(memory__tl_cache__refill_takes_a_batch_from_backing)
+{
+    Allocator backing = vm_freelist_allocator(4 * MiB);
+    Allocator a = tl_cache_allocator(backing);
+
+    AllocatorInfo before = get_allocator_info(backing);
+    void *p0 = ALLOC(a, 32);
+    AllocatorInfo after_first = get_allocator_info(backing);
+    ASSERT(after_first.used >= before.used + M_TL_CACHE_BATCH*32);
+
+    // the rest of the batch is served from the magazine without touching the backing allocator
+    for (i32 i = 1; i < M_TL_CACHE_BATCH; i++) ALLOC(a, 32);
+    AllocatorInfo after_batch = get_allocator_info(backing);
+    ASSERT(after_batch.used == after_first.used);
+
+    FREE(a, p0);
+}
+
+TEST_PROC(memory__tl_cache__full_magazine_flushes_to_backing)
+{
+    Allocator backing = vm_freelist_allocator(4 * MiB);
+    Allocator a = tl_cache_allocator(backing);
+
+    void *ptrs[M_TL_CACHE_MAGAZINE*2];
+    for (void *&p : ptrs) p = ALLOC(a, 64);
+
+    AllocatorInfo before = get_allocator_info(backing);
+    for (void *p : ptrs) FREE(a, p);
+    AllocatorInfo after = get_allocator_info(backing);
+
+    ASSERT(after.used < before.used);
+}
+
+TEST_PROC(memory__tl_cache__large_and_overaligned_allocs_bypass_cache)
+{
+    Allocator a = tl_cache_allocator(vm_freelist_allocator(4 * MiB));
+
+    void *large = ALLOC(a, 64 * KiB);
+    ASSERT(large != nullptr);
+    ASSERT(vm_freelist_header(large)->cache_class == 0);
+
+    void *aligned = ALLOC_A(a, 32, 64);
+    ASSERT(aligned != nullptr);
+    ASSERT(is_aligned(aligned, 64));
+    ASSERT(vm_freelist_header(aligned)->cache_class == 0);
+
+    FREE(a, large);
+    FREE(a, aligned);
+}
+
+TEST_PROC(memory__tl_cache__realloc_within_class_is_inplace)
+{
+    Allocator a = tl_cache_allocator(vm_freelist_allocator(4 * MiB));
+
+    u8 *p = (u8*)ALLOC(a, 40);
+    for (i32 i = 0; i < 40; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC(a, p, 40, 64);
+    ASSERT(r == p);
+    for (i32 i = 0; i < 40; i++) ASSERT(r[i] == (u8)i);
+
+    FREE(a, r);
+}
+
+TEST_PROC(memory__tl_cache__realloc_across_classes_preserves_data)
+{
+    Allocator a = tl_cache_allocator(vm_freelist_allocator(4 * MiB));
+
+    u8 *p = (u8*)ALLOC(a, 64);
+    for (i32 i = 0; i < 64; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC(a, p, 64, 4096);
+    ASSERT(r != nullptr);
+    ASSERT(r != p);
+    for (i32 i = 0; i < 64; i++) ASSERT(r[i] == (u8)i);
+
+    FREE(a, r);
+}
+
+struct TlCacheThreadData {
+    Allocator alloc;
+    u8 index;
+    void *ptrs[100];
+};
+
+static i32 tl_cache_alloc_thread_proc(void *user_data)
+{
+    auto data = (TlCacheThreadData*)user_data;
+    for (void *&p : data->ptrs) {
+        p = ALLOC(data->alloc, 48);
+        memset(p, data->index, 48);
+    }
+
+    return 0;
+}
+
+static i32 tl_cache_free_thread_proc(void *user_data)
+{
+    auto data = (TlCacheThreadData*)user_data;
+    for (void *p : data->ptrs) FREE(data->alloc, p);
+    return 0;
+}
+
+TEST_PROC(memory__tl_cache__free_on_another_thread_flushes_to_backing_on_exit)
+{
+    Allocator backing = vm_freelist_allocator(4 * MiB);
+    Allocator a = tl_cache_allocator(backing);
+    i64 used = get_allocator_info(backing).used;
+
+    Thread *threads[4];
+    TlCacheThreadData data[4];
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        data[i] = {};
+        data[i].alloc = a;
+        data[i].index = (u8)(i+1);
+        threads[i] = create_thread(tl_cache_alloc_thread_proc, &data[i]);
+    }
+    for (Thread *t : threads) join_thread(t);
+
+    for (auto &d : data) {
+        for (void *p : d.ptrs) {
+            ASSERT(p != nullptr);
+            for (i32 i = 0; i < 48; i++) ASSERT(((u8*)p)[i] == d.index);
+        }
+    }
+
+    // each thread frees the blocks another thread allocated, which end up in
+    // the freeing thread's magazines
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        threads[i] = create_thread(tl_cache_free_thread_proc, &data[(i+1) % ARRAY_COUNT(data)]);
+    }
+    for (Thread *t : threads) join_thread(t);
+
+    // the blocks left in the magazines of the allocating and the freeing
+    // threads are flushed back to the backing allocator when they exit
+    ASSERT(get_allocator_info(backing).used == used);
+}
+
+TEST_PROC(memory__slab__alloc_is_aligned_to_size_class)
+{
+    Allocator a = slab_allocator(16 * MiB);
+
+    void *p0 = ALLOC(a, 1);
+    void *p1 = ALLOC(a, 24);
+    void *p2 = ALLOC_A(a, 8, 64);
+    void *p3 = ALLOC(a, 3000);
+    ASSERT(p0 && p1 && p2 && p3);
+
+    ASSERT(is_aligned(p0, 16));
+    ASSERT(is_aligned(p1, 32));
+    ASSERT(is_aligned(p2, 64));
+    ASSERT((size_t)p3 % 4096 == 0);
+
+    FREE(a, p0);
+    FREE(a, p1);
+    FREE(a, p2);
+    FREE(a, p3);
+}
+
+TEST_PROC(memory__slab__free_then_alloc_reuses_slot)
+{
+    Allocator a = slab_allocator(16 * MiB);
+
+    void *keep = ALLOC(a, 48);
+    void *p0 = ALLOC(a, 48);
+    FREE(a, p0);
+
+    void *p1 = ALLOC(a, 60);
+    ASSERT(p1 == p0);
+
+    FREE(a, p1);
+    FREE(a, keep);
 }
 
-TEST_PROC(memory__malloc__free_null_is_safe)
+TEST_PROC(memory__slab__info_reports_per_class_usage)
 {
-    Allocator a = malloc_allocator();
-    // Freeing nullptr must not crash (guarded by `if (old_ptr)` in malloc_alloc)
-    void *ret = FREE(a, nullptr);
-    ASSERT(ret == nullptr);
+    Allocator a = slab_allocator(16 * MiB);
+
+    void *ptrs[10];
+    for (void *&p : ptrs) p = ALLOC(a, 100);
+    void *other = ALLOC(a, 16);
+
+    SlabAllocatorInfo info = get_slab_allocator_info(a);
+    ASSERT(info.classes[0].size == 16);
+    ASSERT(info.classes[0].used == 1);
+    ASSERT(info.classes[3].size == 128);
+    ASSERT(info.classes[3].used == 10);
+    ASSERT(info.classes[3].slabs == 1);
+    ASSERT(info.classes[3].capacity >= info.classes[3].used);
+    ASSERT(info.used == 10*128 + 16);
+    ASSERT(info.size >= 16 * MiB);
+
+    for (void *p : ptrs) FREE(a, p);
+    FREE(a, other);
+
+    info = get_slab_allocator_info(a);
+    ASSERT(info.classes[3].used == 0);
+    ASSERT(info.used == 0);
 }
 
-TEST_PROC(memory__malloc__realloc_preserves_data)
+TEST_PROC(memory__slab__full_slab_spills_into_new_slab)
 {
-    Allocator a = malloc_allocator();
+    Allocator a = slab_allocator(16 * MiB);
 
-    u8 *p = (u8*)ALLOC(a, 64);
-    for (i32 i = 0; i < 64; i++) p[i] = (u8)i;
+    i32 count = M_SLAB_SIZE / 1024;
+    void **ptrs = (void**)ALLOC(a, count*sizeof(void*));
+    for (i32 i = 0; i < count; i++) ptrs[i] = ALLOC(a, 1024);
 
-    u8 *r = (u8*)REALLOC(a, p, 64, 128);
-    ASSERT(r != nullptr);
-    for (i32 i = 0; i < 64; i++) ASSERT(r[i] == (u8)i);
+    SlabAllocatorInfo info = get_slab_allocator_info(a);
+    ASSERT(info.classes[6].slabs == 2);
+    ASSERT(info.classes[6].used == count);
 
-    FREE(a, r);
+    // the emptied slab is returned once the class has another partial slab
+    for (i32 i = 0; i < count; i++) FREE(a, ptrs[i]);
+    info = get_slab_allocator_info(a);
+    ASSERT(info.classes[6].slabs == 1);
+    ASSERT(info.classes[6].used == 0);
+
+    FREE(a, ptrs);
 }
 
-TEST_PROC(memory__malloc__realloc_null_ptr_acts_as_alloc)
+TEST_PROC(memory__slab__large_alloc_run_is_recycled)
 {
-    Allocator a = malloc_allocator();
-    void *p = REALLOC(a, nullptr, 0, 64);
-    ASSERT(p != nullptr);
-    FREE(a, p);
+    Allocator a = slab_allocator(16 * MiB);
+
+    u8 *p0 = (u8*)ALLOC(a, 100 * KiB);
+    ASSERT(p0 != nullptr);
+    memset(p0, 0xcd, 100 * KiB);
+
+    SlabAllocatorInfo info = get_slab_allocator_info(a);
+    ASSERT(info.large_count == 1);
+    ASSERT(info.large_used >= 100 * KiB);
+
+    FREE(a, p0);
+    info = get_slab_allocator_info(a);
+    ASSERT(info.large_count == 0);
+    ASSERT(info.large_used == 0);
+
+    u8 *p1 = (u8*)ALLOC(a, 90 * KiB);
+    ASSERT(p1 == p0);
+    memset(p1, 0xab, 90 * KiB);
+    FREE(a, p1);
 }
 
-TEST_PROC(memory__malloc__extend_is_fresh_alloc_no_copy)
+TEST_PROC(memory__slab__realloc_preserves_data)
 {
-    Allocator a = malloc_allocator();
+    Allocator a = slab_allocator(16 * MiB);
 
-    u8 *p = (u8*)ALLOC(a, 64);
-    for (i32 i = 0; i < 64; i++) p[i] = (u8)i;
+    u8 *p = (u8*)ALLOC(a, 40);
+    for (i32 i = 0; i < 40; i++) p[i] = (u8)i;
 
-    u8 *r = (u8*)ALLOC_PROC(a, M_EXTEND, p, 64, 128, M_DEFAULT_ALIGN);
-    ASSERT(r != nullptr);
+    u8 *r = (u8*)REALLOC(a, p, 40, 64);
+    ASSERT(r == p);
+
+    r = (u8*)REALLOC(a, r, 64, 200 * KiB);
     ASSERT(r != p);
-    // Old pointer is NOT freed by extend -- caller is responsible.
-    FREE(a, p);
+    for (i32 i = 0; i < 40; i++) ASSERT(r[i] == (u8)i);
+
     FREE(a, r);
 }
 
-TEST_PROC(memory__malloc__reset_logs_error_and_returns_null)
+TEST_PROC(memory__slab__alloc_beyond_reserve_fails)
 {
-    Allocator a = malloc_allocator();
-    EXPECT_FAIL(RESET_ALLOC(a));
+    Allocator a = slab_allocator(4 * M_SLAB_SIZE);
+
+    void *p0 = ALLOC(a, 3 * M_SLAB_SIZE);
+    ASSERT(p0 != nullptr);
+
+    EXPECT_FAIL(ALLOC(a, 3 * M_SLAB_SIZE));
 }
 
-TEST_PROC(memory__malloc__get_allocator_info_reports_zero_usage)
+
+#define TRACKED_ALLOC(alloc, size) (mem_callsite = MemCallsite{ __FILE__, __LINE__ }, ALLOC(alloc, size))
+
+TEST_PROC(memory__tracking__info_reports_live_and_peak_bytes)
 {
-    Allocator a = malloc_allocator();
+    Allocator a = tracking_allocator(malloc_allocator());
+
+    void *p0 = ALLOC(a, 100);
+    void *p1 = ALLOC(a, 200);
 
     AllocatorInfo info = get_allocator_info(a);
-    ASSERT(info.size == 0);
+    ASSERT(info.used == 300);
+    ASSERT(info.peak == 300);
+    ASSERT(info.alloc_count == 2);
+
+    FREE(a, p0);
+    info = get_allocator_info(a);
+    ASSERT(info.used == 200);
+    ASSERT(info.peak == 300);
+    ASSERT(info.alloc_count == 2);
+
+    FREE(a, p1);
+    info = get_allocator_info(a);
     ASSERT(info.used == 0);
 }
 
-TEST_PROC(memory__malloc__get_allocator_info_stays_zero_after_allocations)
+TEST_PROC(memory__tracking__attributes_allocations_to_callsites)
 {
-    Allocator a = malloc_allocator();
+    Allocator a = tracking_allocator(malloc_allocator());
 
-    void *p = ALLOC(a, 256);
-    ASSERT(p != nullptr);
+    void *ptrs[3];
+    for (void *&p : ptrs) p = TRACKED_ALLOC(a, 64);
+    void *big = TRACKED_ALLOC(a, 1024);
+    FREE(a, ptrs[0]);
 
-    AllocatorInfo info = get_allocator_info(a);
-    ASSERT(info.size == 0);
-    ASSERT(info.used == 0);
+    TrackedCallsite sites[4];
+    i32 count = get_tracked_callsites(a, sites, ARRAY_COUNT(sites));
+    ASSERT(count == 2);
 
-    FREE(a, p);
+    // sorted by live bytes
+    ASSERT(sites[0].live_bytes == 1024);
+    ASSERT(sites[0].count == 1);
+
+    ASSERT(sites[1].file == sites[0].file);
+    ASSERT(sites[1].line < sites[0].line);
+    ASSERT(sites[1].count == 3);
+    ASSERT(sites[1].bytes == 3*64);
+    ASSERT(sites[1].live_count == 2);
+    ASSERT(sites[1].live_bytes == 2*64);
+    ASSERT(sites[1].peak_bytes == 3*64);
+
+    log_tracking_report(a);
+
+    FREE(a, ptrs[1]);
+    FREE(a, ptrs[2]);
+    FREE(a, big);
 }
 
-TEST_PROC(memory__vm_freelist__get_allocator_info_reports_capacity)
+TEST_PROC(memory__tracking__untracked_allocations_share_an_entry)
 {
-    Allocator a = vm_freelist_allocator(4 * MiB);
+    Allocator a = tracking_allocator(malloc_allocator());
+
+    mem_callsite = {};
+    void *p0 = a.proc(a.state, M_ALLOC, nullptr, 0, 16, M_DEFAULT_ALIGN);
+    void *p1 = a.proc(a.state, M_ALLOC, nullptr, 0, 16, M_DEFAULT_ALIGN);
+
+    TrackedCallsite sites[4];
+    i32 count = get_tracked_callsites(a, sites, ARRAY_COUNT(sites));
+    ASSERT(count == 1);
+    ASSERT(sites[0].count == 2);
+
+    FREE(a, p0);
+    FREE(a, p1);
+}
+
+TEST_PROC(memory__tracking__realloc_preserves_data_and_alignment)
+{
+    Allocator a = tracking_allocator(malloc_allocator());
+
+    u8 *p = (u8*)ALLOC_A(a, 40, 64);
+    ASSERT(is_aligned(p, 64));
+    for (i32 i = 0; i < 40; i++) p[i] = (u8)i;
+
+    u8 *r = (u8*)REALLOC_A(a, p, 40, 4096, 64);
+    ASSERT(is_aligned(r, 64));
+    for (i32 i = 0; i < 40; i++) ASSERT(r[i] == (u8)i);
 
     AllocatorInfo info = get_allocator_info(a);
-    ASSERT(info.size >= 4 * MiB);
-    ASSERT(info.used == 0);
+    ASSERT(info.used == 4096);
+
+    FREE(a, r);
 }
 
-TEST_PROC(memory__vm_freelist__get_allocator_info_tracks_alloc_and_free)
+TEST_PROC(memory__tracking__out_of_place_extend_keeps_old_allocation_live)
 {
-    Allocator a = vm_freelist_allocator(4 * MiB);
+    Allocator a = tracking_allocator(tl_linear_allocator(4096));
 
-    AllocatorInfo before = get_allocator_info(a);
-    void *p = ALLOC(a, 4096);
-    ASSERT(p != nullptr);
+    void *p = ALLOC(a, 64);
+    ALLOC(a, 16);
 
-    AllocatorInfo after_alloc = get_allocator_info(a);
-    ASSERT(after_alloc.used >= before.used + 4096);
+    void *r = ALLOC_PROC(a, M_EXTEND, p, 64, 128, M_DEFAULT_ALIGN);
+    ASSERT(r != p);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used == 64 + 16 + 128);
 
     FREE(a, p);
+    info = get_allocator_info(a);
+    ASSERT(info.used == 16 + 128);
+}
 
-    AllocatorInfo after_free = get_allocator_info(a);
-    ASSERT(after_free.used == before.used);
-    ASSERT(after_free.size == before.size);
+static AllocatorSnapshot* find_allocator_snapshot(AllocatorSnapshot *snapshots, i32 count, const char *name)
+{
+    for (i32 i = 0; i < count; i++) {
+        if (snapshots[i].name == name) return &snapshots[i];
+    }
+    return nullptr;
 }
 
-TEST_PROC(memory__vm_freelist__near_exact_initial_alloc_succeeds)
+TEST_PROC(memory__telemetry__constructors_register_allocators)
 {
-    Allocator a = vm_freelist_allocator(4 * MiB);
-    auto *state = (VMFreeListState*)a.state;
+    static const char *name = "telemetry/registered";
+    Allocator a = linear_allocator(64 * KiB, 0, name);
+    ALLOC(a, 1024);
 
-    void *p = ALLOC(a, vm_freelist_near_exact_page_request_size(state));
-    ASSERT(p != nullptr);
-    ASSERT(state->committed > 0);
+    AllocatorSnapshot *snapshots = (AllocatorSnapshot*)malloc(1024 * sizeof *snapshots);
+    defer { free(snapshots); };
 
-    FREE(a, p);
+    i32 count = get_allocator_snapshots(snapshots, 1024);
+    ASSERT(count > 0);
+
+    AllocatorSnapshot *snapshot = find_allocator_snapshot(snapshots, count, name);
+    ASSERT(snapshot != nullptr);
+    ASSERT(snapshot->thread_owner == thread_id());
+    ASSERT(snapshot->info.used >= 1024);
+    ASSERT(snapshot->info.alloc_count == 1);
 }
 
-TEST_PROC(memory__vm_freelist__free_then_exact_fit_reuses_committed_page)
+TEST_PROC(memory__telemetry__snapshots_respect_max_count)
 {
-    Allocator a = vm_freelist_allocator(4 * MiB);
-    auto *state = (VMFreeListState*)a.state;
+    linear_allocator(4096, 0, "telemetry");
+    linear_allocator(4096, 0, "telemetry");
 
-    i64 size = vm_freelist_exact_page_request_size(state);
+    AllocatorSnapshot snapshots[1];
+    ASSERT(get_allocator_snapshots(snapshots, 1) == 1);
+    ASSERT(get_allocator_snapshots(snapshots, 0) == 0);
+}
 
-    void *p0 = ALLOC(a, size);
-    ASSERT(p0 != nullptr);
-    i64 committed_after_first_alloc = state->committed;
-    ASSERT(committed_after_first_alloc > 0);
+TEST_PROC(memory__telemetry__tl_linear_peak_survives_reset)
+{
+    Allocator a = tl_linear_allocator(64 * MiB);
 
-    FREE(a, p0);
-    ASSERT(state->committed == committed_after_first_alloc);
+    ALLOC(a, 4 * MiB);
+    ALLOC(a, 1 * MiB);
+    RESET_ALLOC(a);
+    ALLOC(a, 1 * MiB);
 
-    void *p1 = ALLOC(a, size);
-    ASSERT(p1 != nullptr);
-    ASSERT(state->committed == committed_after_first_alloc);
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used >= 1 * MiB && info.used < 2 * MiB);
+    ASSERT(info.peak >= 5 * MiB);
+    ASSERT(info.committed >= info.used);
+    ASSERT(info.alloc_count == 3);
+    ASSERT(info.fragmentation == 0.0f);
+}
 
-    FREE(a, p1);
+TEST_PROC(memory__telemetry__tl_arena_reports_chain_usage)
+{
+    MArena a = tl_arena(1 * KiB, "telemetry");
+    AllocatorInfo before = get_allocator_info(a);
+
+    ALLOC(a, 512);
+    ALLOC(a, 4 * KiB);
+
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used >= 512 + 4 * KiB);
+    ASSERT(info.size >= 1 * KiB + 4 * KiB);
+    ASSERT(info.committed == info.size);
+    ASSERT(info.alloc_count == before.alloc_count + 2);
+
+    release_arena(&a);
 }
 
-TEST_PROC(memory__vm_freelist__free_then_near_exact_fit_reuses_committed_page)
+TEST_PROC(memory__telemetry__vm_freelist_reports_fragmentation)
 {
     Allocator a = vm_freelist_allocator(4 * MiB);
-    auto *state = (VMFreeListState*)a.state;
 
-    i64 exact_size = vm_freelist_exact_page_request_size(state);
-    i64 near_size = vm_freelist_near_exact_page_request_size(state);
+    void *ptrs[8];
+    for (i32 i = 0; i < 8; i++) ptrs[i] = ALLOC(a, 1024);
 
-    void *p0 = ALLOC(a, exact_size);
-    ASSERT(p0 != nullptr);
+    AllocatorInfo full = get_allocator_info(a);
+    ASSERT(full.alloc_count == 8);
+    ASSERT(full.peak == full.used);
 
-    FREE(a, p0);
-    i64 committed_after_free = state->committed;
-    ASSERT(committed_after_free > 0);
+    // NOTE(jesper): one large free block next to the small holes, so that
+    // the allocator isn't entirely fragmented
+    void *large = ALLOC(a, 64 * KiB);
+    FREE(a, large);
+    full = get_allocator_info(a);
 
-    void *p1 = ALLOC(a, near_size);
-    ASSERT(p1 != nullptr);
-    ASSERT(state->committed == committed_after_free);
+    for (i32 i = 0; i < 8; i += 2) FREE(a, ptrs[i]);
 
-    FREE(a, p1);
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used < full.used);
+    ASSERT(info.peak == full.peak);
+    ASSERT(info.committed == full.committed);
+    ASSERT(info.fragmentation > 0.0f && info.fragmentation < 1.0f);
 }
 
-TEST_PROC(memory__vm_freelist__alternating_near_page_sizes_do_not_grow_committed)
+TEST_PROC(memory__telemetry__slab_reports_peak_commit_and_fragmentation)
 {
-    Allocator a = vm_freelist_allocator(4 * MiB);
-    auto *state = (VMFreeListState*)a.state;
+    static const char *name = "telemetry/slab";
+    Allocator a = slab_allocator(16 * MiB, name);
 
-    i64 near_size = vm_freelist_near_exact_page_request_size(state);
+    void *ptrs[10];
+    for (void *&p : ptrs) p = ALLOC(a, 100);
+    void *large = ALLOC(a, 256 * KiB);
 
-    void *seed = ALLOC(a, vm_freelist_exact_page_request_size(state));
-    ASSERT(seed != nullptr);
-    FREE(a, seed);
+    AllocatorInfo full = get_allocator_info(a);
+    ASSERT(full.alloc_count == 11);
+    ASSERT(full.peak == full.used);
+    ASSERT(full.committed >= full.used);
 
-    i64 committed_baseline = state->committed;
-    ASSERT(committed_baseline > 0);
+    FREE(a, large);
+    for (i32 i = 0; i < 10; i += 2) FREE(a, ptrs[i]);
 
-    for (i32 i = 0; i < 8; i++) {
-        i64 size = (i & 1) ? near_size : vm_freelist_exact_page_request_size(state);
+    AllocatorInfo info = get_allocator_info(a);
+    ASSERT(info.used == 5*128);
+    ASSERT(info.peak == full.peak);
+    ASSERT(info.committed < full.committed);
+    ASSERT(info.alloc_count == 11);
+    ASSERT(info.fragmentation > 0.0f && info.fragmentation <= 1.0f);
 
-        void *p = ALLOC(a, size);
-        ASSERT(p != nullptr);
-        ASSERT(state->committed == committed_baseline);
+    AllocatorSnapshot *snapshots = (AllocatorSnapshot*)malloc(1024 * sizeof *snapshots);
+    defer { free(snapshots); };
 
-        FREE(a, p);
-        ASSERT(state->committed == committed_baseline);
-    }
+    i32 count = get_allocator_snapshots(snapshots, 1024);
+    AllocatorSnapshot *snapshot = find_allocator_snapshot(snapshots, count, name);
+    ASSERT(snapshot != nullptr);
+    ASSERT(snapshot->info.used == info.used);
 }
 
-
 TEST_PROC(memory__scratch__alloc_returns_usable_memory)
 {
     SArena scratch = tl_scratch_arena();
@@ -543,6 +1584,61 @@ TEST_PROC(memory__scratch__conflict_returns_different_arena)
     release_arena(&a);
 }
 
+TEST_PROC(memory__scratch__multiple_conflicts_pick_lowest_free_arena)
+{
+    MArena a = tl_scratch_arena();
+    MArena b = tl_scratch_arena(a);
+    MArena c = tl_scratch_arena({ a, b });
+
+    ASSERT(c.state != a.state);
+    ASSERT(c.state != b.state);
+
+    // arena a is free again once only b conflicts
+    MArena d = tl_scratch_arena({ b, malloc_allocator() });
+    ASSERT(d.state == a.state);
+
+    release_arena(&d);
+    release_arena(&c);
+    release_arena(&b);
+    release_arena(&a);
+}
+
+TEST_PROC(memory__scratch__deep_conflict_chain_cycles_lowest_arenas)
+{
+    MArena arenas[M_SCRATCH_ARENAS];
+    arenas[0] = tl_scratch_arena();
+    arenas[1] = tl_scratch_arena(arenas[0]);
+    for (i32 i = 2; i < M_SCRATCH_ARENAS; i++) {
+        arenas[i] = tl_scratch_arena({ arenas[i-1], arenas[i-2] });
+    }
+
+    // every level only conflicts with the two above it, so the chain cycles
+    // through the lowest three arenas
+    ASSERT(arenas[3].state == arenas[0].state);
+    ASSERT(arenas[2].state != arenas[0].state);
+    ASSERT(arenas[2].state != arenas[1].state);
+
+    for (i32 i = M_SCRATCH_ARENAS-1; i >= 0; i--) release_arena(&arenas[i]);
+}
+
+TEST_PROC(memory__scratch__all_arenas_in_conflict_panics)
+{
+    MArena arenas[M_SCRATCH_ARENAS];
+    Allocator conflicts[M_SCRATCH_ARENAS];
+    for (i32 i = 0; i < M_SCRATCH_ARENAS; i++) {
+        arenas[i] = tl_scratch_arena(conflicts, i);
+        conflicts[i] = arenas[i];
+    }
+
+    for (i32 i = 0; i < M_SCRATCH_ARENAS; i++) {
+        for (i32 j = 0; j < i; j++) ASSERT(arenas[i].state != arenas[j].state);
+    }
+
+    EXPECT_FAIL(tl_scratch_arena(conflicts, M_SCRATCH_ARENAS));
+
+    for (i32 i = M_SCRATCH_ARENAS-1; i >= 0; i--) release_arena(&arenas[i]);
+}
+
 TEST_PROC(memory__scratch__non_scratch_conflict_still_returns_arena)
 {
     Allocator heap = malloc_allocator();
@@ -959,6 +2055,68 @@ TEST_PROC(memory__scratch__multiple_allocs_accumulate_before_release)
     ASSERT(a != b && b != c && a != c);
 }
 
+struct ScratchThreadData {
+    u8 index;
+    void *arenas[2];
+    bool ok;
+};
+
+static i32 scratch_thread_proc(void *user_data)
+{
+    auto data = (ScratchThreadData*)user_data;
+    data->ok = true;
+
+    for (i32 i = 0; i < 200; i++) {
+        SArena outer = tl_scratch_arena();
+        i64 used = get_allocator_info(outer).used;
+
+        u8 *a = (u8*)ALLOC(outer, 4096);
+        memset(a, data->index, 4096);
+
+        {
+            SArena inner = tl_scratch_arena(outer);
+            u8 *b = (u8*)ALLOC(inner, 64 * KiB);
+            memset(b, data->index+100, 64 * KiB);
+
+            data->arenas[0] = outer->state;
+            data->arenas[1] = inner->state;
+
+            for (i32 j = 0; j < 64 * KiB; j++) data->ok = data->ok && b[j] == data->index+100;
+        }
+
+        for (i32 j = 0; j < 4096; j++) data->ok = data->ok && a[j] == data->index;
+
+        restore_arena(&outer.arena);
+        data->ok = data->ok && get_allocator_info(outer).used == used;
+    }
+
+    return 0;
+}
+
+TEST_PROC(memory__scratch__concurrent_threads_use_isolated_arenas)
+{
+    Thread *threads[4];
+    ScratchThreadData data[4];
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        data[i] = { .index = (u8)(i+1) };
+        threads[i] = create_thread(scratch_thread_proc, &data[i]);
+    }
+
+    for (Thread *t : threads) join_thread(t);
+
+    SArena scratch = tl_scratch_arena();
+    for (i32 i = 0; i < ARRAY_COUNT(data); i++) {
+        ASSERT(data[i].ok);
+        ASSERT(data[i].arenas[0] != data[i].arenas[1]);
+        ASSERT(data[i].arenas[0] != scratch->state);
+
+        for (i32 j = 0; j < i; j++) {
+            for (void *arena : data[j].arenas) {
+                ASSERT(arena != data[i].arenas[0] && arena != data[i].arenas[1]);
+            }
+        }
+    }
+}
 
 TEST_PROC(memory__arena__restore_resets_to_creation_point)
 {
@@ -1105,6 +2263,93 @@ TEST_PROC(memory__buffer__typed_write_beyond_end_panics)
 }
 
 
+TEST_PROC(memory__pool__add_and_get)
+{
+    Pool<i32> pool{};
+
+    PoolHandle<i32> h0 = pool_add(&pool, 10);
+    PoolHandle<i32> h1 = pool_add(&pool, 20);
+    ASSERT(h0 && h1);
+    ASSERT(h0 != h1);
+    ASSERT(pool.count == 2);
+
+    ASSERT(*pool_get(&pool, h0) == 10);
+    ASSERT(*pool_get(&pool, h1) == 20);
+
+    pool_destroy(&pool);
+}
+
+TEST_PROC(memory__pool__freed_handle_is_stale)
+{
+    Pool<i32> pool{};
+
+    PoolHandle<i32> h0 = pool_add(&pool, 10);
+    ASSERT(pool_free(&pool, h0));
+    ASSERT(pool_get(&pool, h0) == nullptr);
+    ASSERT(!pool_free(&pool, h0));
+    ASSERT(pool.count == 0);
+
+    // the slot is reused with a new generation
+    PoolHandle<i32> h1 = pool_add(&pool, 30);
+    ASSERT(h1.index == h0.index);
+    ASSERT(h1.gen != h0.gen);
+    ASSERT(pool_get(&pool, h0) == nullptr);
+    ASSERT(*pool_get(&pool, h1) == 30);
+
+    pool_destroy(&pool);
+}
+
+TEST_PROC(memory__pool__growth_keeps_addresses_stable)
+{
+    Pool<i32> pool{};
+
+    PoolHandle<i32> h0 = pool_add(&pool, 1);
+    i32 *p0 = pool_get(&pool, h0);
+
+    for (i32 i = 0; i < POOL_CHUNK_SIZE*8; i++) pool_add(&pool, i);
+    ASSERT(pool.chunk_count > 1);
+
+    ASSERT(pool_get(&pool, h0) == p0);
+    ASSERT(*p0 == 1);
+
+    pool_destroy(&pool);
+}
+
+TEST_PROC(memory__pool__invalid_handles_return_null)
+{
+    Pool<i32> pool{};
+    ASSERT(pool_get(&pool, PoolHandle<i32>{}) == nullptr);
+
+    PoolHandle<i32> h = pool_add(&pool, 1);
+    ASSERT(pool_get(&pool, PoolHandle<i32>{ h.index, h.gen+1 }) == nullptr);
+    ASSERT(pool_get(&pool, PoolHandle<i32>{ POOL_CHUNK_SIZE*4, 1 }) == nullptr);
+    ASSERT(!PoolHandle<i32>{});
+
+    pool_destroy(&pool);
+}
+
+TEST_PROC(memory__pool__free_and_destroy_run_destructors)
+{
+    static i32 destroyed = 0;
+    struct Counted {
+        i32 v = 0;
+        ~Counted() { destroyed++; }
+    };
+
+    destroyed = 0;
+    Pool<Counted> pool{};
+    PoolHandle<Counted> h0 = pool_alloc(&pool);
+    pool_alloc(&pool);
+    pool_alloc(&pool);
+
+    i32 before = destroyed;
+    pool_free(&pool, h0);
+    ASSERT(destroyed == before+1);
+
+    pool_destroy(&pool);
+    ASSERT(destroyed == before+3);
+}
+
 TEST_PROC(memory__macros__alloc_t_constructs_typed_object)
 {
     Allocator a = malloc_allocator();
@@ -15,8 +15,28 @@ void lock_mutex(Mutex*);
 void unlock_mutex(Mutex*);
 
 Thread* create_thread(ThreadProc proc, void *user_data = nullptr);
+
+// NOTE(jesper): blocks until the thread's proc returns, releases the thread and
+// returns the proc's result. The Thread* is invalid afterwards
+i32 join_thread(Thread *thread);
+
+// NOTE(jesper): gives up the rest of the calling thread's time slice
+void yield_thread();
+
+// NOTE(jesper): backoff for spin-waits, called on each failed iteration with a
+// counter starting at 0. Pauses for the first few iterations, then yields so
+// that a waiter doesn't keep the thread it's waiting on from running when
+// there are more threads than cores
+inline void spin_wait(i32 *spins)
+{
+    if ((*spins)++ < 64) cpu_pause();
+    else yield_thread();
+}
+
 i32 thread_id();
 
+i32 hardware_thread_count();
+
 #include "generated/thread.h"
 
 #endif // THREAD_H
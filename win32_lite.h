@@ -64,6 +64,8 @@
 
 #define MEM_COMMIT 0x00001000
 #define MEM_RESERVE 0x00002000
+#define MEM_DECOMMIT 0x00004000
+#define MEM_RELEASE 0x00008000
 #define MEM_RESET 0x00080000
 #define MEM_RESET_UNDO 0x1000000
 #define MEM_LARGE_PAGES 0x20000000
@@ -661,6 +663,13 @@ extern "C" {
         DWORD  flAllocationType,
         DWORD  flProtect);
 
+    BOOL VirtualFree(
+        LPVOID lpAddress,
+        SIZE_T dwSize,
+        DWORD  dwFreeType);
+
+    SIZE_T GetLargePageMinimum();
+
     void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo);
 
     HANDLE CreateThread(
@@ -713,6 +722,7 @@ extern "C" {
     BOOL ReleaseMutex(HANDLE hMutex);
 
     void Sleep(DWORD dwMilliseconds);
+    WINDLL BOOL SwitchToThread();
 
     WINDLL DWORD GetLastError();
 
@@ -4,13 +4,90 @@
 
 #include "win32_lite.h"
 
+i32 get_page_size()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+}
+
+// NOTE(jesper): windows can only place memory on a NUMA node when it's
+// allocated, with VirtualAllocExNuma, which isn't hooked up. M_NUMA_LOCAL is
+// never obtained
+i32 current_numa_node()
+{
+    return -1;
+}
+
+i32 virtual_numa_node(void * /*addr*/)
+{
+    return -1;
+}
+
+void* virtual_reserve(i64 size, u32 flags, u32 *obtained_flags, i32 *numa_node)
+{
+    if (obtained_flags) *obtained_flags = 0;
+    if (numa_node) *numa_node = -1;
+
+    // NOTE(jesper): windows has no transparent huge pages, both flags try large
+    // pages, which are committed on reserve and require SeLockMemoryPrivilege
+    SIZE_T large_page_size = flags & (M_HUGE_PAGES|M_HUGE_PAGES_EXPLICIT) ? GetLargePageMinimum() : 0;
+    if (large_page_size > 0) {
+        i64 large_size = (size + large_page_size-1) & ~(i64)(large_page_size-1);
+        void *mem = VirtualAlloc(NULL, large_size, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (mem) {
+            if (obtained_flags) *obtained_flags = M_HUGE_PAGES_EXPLICIT;
+            return mem;
+        }
+
+        LOG_INFO("failed to allocate %lld bytes of large pages, falling back to regular pages", large_size);
+    }
+
+    void *mem = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
+    if (!mem) LOG_ERROR("failed to reserve %lld bytes of virtual memory", size);
+    return mem;
+}
+
 void* virtual_commit(void *addr, i64 size)
 {
 	void *ptr = VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE);
 	return ptr;
 }
 
-Allocator vm_freelist_allocator(i64 max_size)
+void virtual_decommit(void *addr, i64 size)
+{
+    if (!VirtualFree(addr, size, MEM_DECOMMIT)) LOG_ERROR("failed to decommit %lld bytes at [%p]", size, addr);
+}
+
+void* virtual_map(i64 size)
+{
+    void *mem = VirtualAlloc(NULL, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if (!mem) LOG_ERROR("failed to map %lld bytes of memory", size);
+    return mem;
+}
+
+void virtual_unmap(void *addr, i64 /*size*/)
+{
+    if (!VirtualFree(addr, 0, MEM_RELEASE)) LOG_ERROR("failed to unmap memory at [%p]", addr);
+}
+
+void* virtual_remap(void *addr, i64 old_size, i64 size, bool may_move)
+{
+    // NOTE(jesper): windows has no equivalent of mremap, and a mapping can't be
+    // grown in place without it becoming a separate allocation. Shrinking keeps
+    // the mapping as is, and growing copies into a new mapping
+    if (size <= old_size) return addr;
+    if (!may_move) return nullptr;
+
+    void *mem = virtual_map(size);
+    if (!mem) return nullptr;
+
+    memcpy(mem, addr, old_size);
+    virtual_unmap(addr, old_size);
+    return mem;
+}
+
+Allocator vm_freelist_allocator(i64 max_size, u32 flags, const char *name)
 {
     extern void* vm_freelist_alloc(
         void *v_state,
@@ -24,7 +101,10 @@ Allocator vm_freelist_allocator(i64 max_size)
     GetSystemInfo(&si);
 
     i64 reserve_size = ROUND_TO(max_size, si.dwPageSize);
-    void *mem = VirtualAlloc(NULL, reserve_size, MEM_RESERVE, PAGE_READWRITE);
+
+    u32 obtained_flags;
+    void *mem = virtual_reserve(reserve_size, flags, &obtained_flags);
+    PANIC_IF(!mem, "failed to reserve memory for vm_freelist_allocator");
 
     VMFreeListState *state = (VMFreeListState *)malloc(sizeof *state);
     state->mem = (u8*)mem;
@@ -33,6 +113,14 @@ Allocator vm_freelist_allocator(i64 max_size)
     state->mutex = create_mutex();
     state->free_block = nullptr;
     state->page_size = si.dwPageSize;
+    state->flags = obtained_flags;
+    state->used = 0;
+    state->peak = 0;
+    state->alloc_count = 0;
+    state->small_free = 0;
+    state->numa_node = -1;
 
-    return Allocator{ state, vm_freelist_alloc };
+    Allocator alloc{ state, vm_freelist_alloc };
+    register_allocator(alloc, name);
+    return alloc;
 }
@@ -7,6 +7,7 @@ struct Thread {
     HANDLE handle;
     ThreadProc user_proc;
     void *user_data;
+    i32 result;
 };
 
 Mutex* create_mutex()
@@ -41,14 +42,39 @@ Thread* create_thread(ThreadProc proc, void *user_data)
         [](LPVOID data) -> DWORD
         {
             Thread *t = (Thread*)data;
-            return t->user_proc(t->user_data);
+            t->result = t->user_proc(t->user_data);
+            return (DWORD)t->result;
         },
         t, 0, NULL);
 
     return t;
 }
 
+i32 join_thread(Thread *t)
+{
+    extern Allocator mem_sys;
+
+    WaitForSingleObject(t->handle, TIMEOUT_INFINITE);
+    CloseHandle(t->handle);
+
+    i32 result = t->result;
+    FREE(mem_sys, t);
+    return result;
+}
+
+void yield_thread()
+{
+    SwitchToThread();
+}
+
 i32 thread_id() 
 {
     return (i32)GetCurrentThreadId();
 }
+
+i32 hardware_thread_count()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return MAX((i32)si.dwNumberOfProcessors, 1);
+}
@@ -463,8 +463,8 @@ struct InputCursor {
 struct InputMap {
     String name;
 
-    DynamicArray<InputDesc> by_device[IDEVICE_MAX][ITYPE_MAX];
-    DynamicArray<InputDesc> by_type[ITYPE_MAX][IDEVICE_MAX];
+    SmallArray<InputDesc, 4> by_device[IDEVICE_MAX][ITYPE_MAX];
+    SmallArray<InputDesc, 4> by_type[ITYPE_MAX][IDEVICE_MAX];
 
     DynamicMap<InputId, i32> edges;
     DynamicMap<InputId, bool> held;